@@ -0,0 +1,359 @@
+/*----------------------------------------------------------------------
+  | ITSOL benchmarks
+  |----------------------------------------------------------------------
+  | bench [-r reps] [-d dir] [-o file] [-q]
+  |
+  |   -r  number of timed runs of each measurement (default 5)
+  |   -d  directory holding pores3.coo and sherman5.coo (default .)
+  |   -o  JSON output file (default: standard output)
+  |   -q  quick run: smaller generated matrices, no end-to-end runs on
+  |       the block one
+  |
+  | Times the kernels itsol_matvec, itsol_lusolC, itsol_vblusolC and
+  | itsol_armsol2, then assemble + solve for every preconditioner and
+  | solver type, on the example matrices and on matrices generated by
+  | itsol_gen_convdiff, itsol_gen_poisson and itsol_gen_block. Every
+  | measurement is repeated and reported as the min and the median of
+  | the runs, in seconds. The messages of the library go to the null
+  | device, the results are written as one JSON document.
+  +---------------------------------------------------------------------*/
+#include "itsol.h"
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+/* a kernel call is timed in batches of at least this many seconds */
+#define BATCH_TIME  0.02
+
+typedef struct bench_mat_
+{
+    char name[64];
+    ITS_CooMat A;
+    int solve;                  /* end-to-end runs on this matrix */
+
+} bench_mat_;
+
+static const char *pc_names_[] = {"NONE", "ARMS", "ILUK", "ILUT", "ILUC", "VBILUK", "VBILUT", "PARILU"};
+static const char *solver_names_[] = {"FGMRES", "BICGSTAB", "BICGSTABL", "BFGMRES", "PGMRES"};
+
+static FILE *null_;
+
+/*-------------------- min and median of t[0..n-1], t is sorted */
+static int cmp_(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void summary_(FILE *fp, const char *key, double *t, int n)
+{
+    double med;
+
+    qsort(t, n, sizeof(double), cmp_);
+    med = n % 2 ? t[n / 2] : 0.5 * (t[n / 2 - 1] + t[n / 2]);
+
+    fprintf(fp, "\"%s\": {\"min\": %.6e, \"median\": %.6e}", key, t[0], med);
+}
+
+/*-------------------- solver setup */
+
+static void quiet_(ITS_SOLVER *s)
+{
+    s->log = s->pc.log = null_;
+    s->pars.fp = null_;
+    s->pars.verb = 0;
+    s->pars.ipar[3] = 0;        /* ARMS level statistics */
+}
+
+/* rhs = A * ones */
+static void rhs_(ITS_CooMat *A, double *b)
+{
+    ITS_INT k;
+
+    memset(b, 0, A->n * sizeof(double));
+    for (k = 0; k < A->nnz; k++)
+        b[A->ia[k]] += A->ma[k];
+}
+
+/* why a preconditioner type is not run, or NULL */
+static const char *skip_pc_(ITS_PC_TYPE pc)
+{
+    if (pc == ITS_PC_NONE)
+        return "not accepted by itsol_pc_initialize";
+    if (pc == ITS_PC_ILUC)
+        return "not factored by itsol_pc_assemble";
+
+    return NULL;
+}
+
+/*-------------------- kernels */
+
+typedef struct kernel_
+{
+    const char *name;
+    int which;                  /* 0 matvec, 1 lusolC, 2 vblusolC, 3 armsol2 */
+    ITS_SOLVER *s;
+    double *x, *y;
+
+} kernel_;
+
+static void call_(kernel_ *k)
+{
+    int n = k->s->csmat->n;
+
+    switch (k->which) {
+        case 0:
+            itsol_matvec(k->s->csmat, k->x, k->y);
+            break;
+        case 1:
+            itsol_lusolC(k->x, k->y, k->s->pc.ILU);
+            break;
+        case 2:
+            itsol_vblusolC(k->x, k->y, k->s->pc.VBILU);
+            break;
+        default:
+            /* armsol2 solves in place */
+            memcpy(k->y, k->x, n * sizeof(double));
+            itsol_armsol2(k->y, k->s->pc.ARMS);
+            break;
+    }
+}
+
+/* time per call of the kernel, reps batches of calls */
+static void time_kernel_(FILE *fp, const char *mat, kernel_ *k, int reps, int *first)
+{
+    double *t, t0;
+    int i, r, calls = 1;
+
+    /* calls per batch */
+    call_(k);
+    for (;;) {
+        t0 = itsol_get_time();
+        for (i = 0; i < calls; i++) call_(k);
+        if (itsol_get_time() - t0 >= BATCH_TIME || calls >= (1 << 24)) break;
+        calls *= 2;
+    }
+
+    t = (double *)itsol_malloc(reps * sizeof(double), "bench:kernel");
+    for (r = 0; r < reps; r++) {
+        t0 = itsol_get_time();
+        for (i = 0; i < calls; i++) call_(k);
+        t[r] = (itsol_get_time() - t0) / calls;
+    }
+
+    fprintf(fp, "%s\n    {\"kernel\": \"%s\", \"matrix\": \"%s\", \"calls\": %d, ", *first ? "" : ",",
+            k->name, mat, calls);
+    summary_(fp, "time", t, reps);
+    fprintf(fp, "}");
+    *first = 0;
+
+    free(t);
+}
+
+static void bench_kernels_(FILE *fp, bench_mat_ *m, int reps, int *first)
+{
+    static const ITS_PC_TYPE pcs[] = {ITS_PC_ILUT, ITS_PC_ILUT, ITS_PC_VBILUT, ITS_PC_ARMS};
+    static const char *names[] = {"itsol_matvec", "itsol_lusolC", "itsol_vblusolC", "itsol_armsol2"};
+    ITS_SOLVER s;
+    kernel_ k;
+    int i, n = m->A.n;
+
+    k.x = (double *)itsol_malloc(n * sizeof(double), "bench:kernels");
+    k.y = (double *)itsol_malloc(n * sizeof(double), "bench:kernels");
+    for (i = 0; i < n; i++) k.x[i] = 1.0 + (i % 7) * 0.1;
+
+    for (i = 0; i < 4; i++) {
+        itsol_solver_initialize(&s, ITS_SOLVER_FGMRES, pcs[i], &m->A);
+        quiet_(&s);
+
+        if (itsol_solver_assemble(&s) == 0) {
+            k.name = names[i];
+            k.which = i;
+            k.s = &s;
+            time_kernel_(fp, m->name, &k, reps, first);
+        }
+
+        itsol_solver_finalize(&s);
+    }
+
+    free(k.x);
+    free(k.y);
+}
+
+/*-------------------- assemble + solve */
+
+static void bench_solve_(FILE *fp, bench_mat_ *m, ITS_PC_TYPE pc, ITS_SOLVER_TYPE st, int reps, int *first)
+{
+    ITS_SOLVER s;
+    double *x, *b, *ta, *ts, t0, res = 0;
+    const char *skip = skip_pc_(pc);
+    int r, n = m->A.n, ierr = 0, status = 0, nits = 0;
+
+    fprintf(fp, "%s\n    {\"matrix\": \"%s\", \"pc\": \"%s\", \"solver\": \"%s\"", *first ? "" : ",",
+            m->name, pc_names_[pc], solver_names_[st]);
+    *first = 0;
+
+    if (skip != NULL) {
+        fprintf(fp, ", \"skipped\": \"%s\"}", skip);
+        return;
+    }
+
+    x = (double *)itsol_malloc(n * sizeof(double), "bench:solve");
+    b = (double *)itsol_malloc(n * sizeof(double), "bench:solve");
+    ta = (double *)itsol_malloc(reps * sizeof(double), "bench:solve");
+    ts = (double *)itsol_malloc(reps * sizeof(double), "bench:solve");
+    rhs_(&m->A, b);
+
+    for (r = 0; r < reps; r++) {
+        itsol_solver_initialize(&s, st, pc, &m->A);
+        quiet_(&s);
+
+        t0 = itsol_get_time();
+        ierr = itsol_solver_assemble(&s);
+        ta[r] = itsol_get_time() - t0;
+
+        if (ierr == 0) {
+            memset(x, 0, n * sizeof(double));
+
+            t0 = itsol_get_time();
+            status = itsol_solver_solve(&s, x, b);
+            ts[r] = itsol_get_time() - t0;
+
+            nits = s.nits;
+            res = s.res;
+        }
+
+        itsol_solver_finalize(&s);
+        if (ierr != 0) break;
+    }
+
+    if (ierr != 0) {
+        fprintf(fp, ", \"assemble_error\": %d}", ierr);
+    }
+    else {
+        fprintf(fp, ", \"status\": %d, \"nits\": %d, \"res\": %.6e, ", status, nits, res);
+        summary_(fp, "assemble", ta, reps);
+        fprintf(fp, ", ");
+        summary_(fp, "solve", ts, reps);
+        fprintf(fp, "}");
+    }
+
+    free(x);
+    free(b);
+    free(ta);
+    free(ts);
+}
+
+int main(int argc, char **argv)
+{
+    bench_mat_ mats[5];
+    char *dir = ".", *out = NULL, fname[ITS_MAX_LINE];
+    const char *files[] = {"pores3", "sherman5"};
+    int i, m, nmat = 0, reps = 5, quick = 0, first;
+    ITS_PC_TYPE pc;
+    ITS_SOLVER_TYPE st;
+    FILE *fp, *test;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            dir = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            out = argv[++i];
+        else if (strcmp(argv[i], "-q") == 0)
+            quick = 1;
+        else {
+            fprintf(stderr, "usage: %s [-r reps] [-d dir] [-o file.json] [-q]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (reps < 1) reps = 1;
+
+    if ((null_ = fopen(NULL_DEVICE, "w")) == NULL) {
+        fprintf(stderr, "cannot open %s\n", NULL_DEVICE);
+        return 1;
+    }
+
+    /* matrices */
+    for (i = 0; i < 2; i++) {
+        snprintf(fname, ITS_MAX_LINE, "%s/%s.coo", dir, files[i]);
+        if ((test = fopen(fname, "r")) == NULL) {
+            fprintf(stderr, "%s not found, skipped\n", fname);
+            continue;
+        }
+        fclose(test);
+
+        snprintf(mats[nmat].name, sizeof(mats[nmat].name), "%s", files[i]);
+        mats[nmat].A = itsol_read_coo(fname);
+        mats[nmat].solve = 1;
+        nmat++;
+    }
+
+    /* generated matrices, see matgen.h */
+    m = quick ? 50 : 100;
+    snprintf(mats[nmat].name, sizeof(mats[nmat].name), "convdiff2d_%d", m);
+    itsol_gen_convdiff(m, m, 1, 100.0, 1.0, 0.5, 0.0, 0, &mats[nmat].A);
+    mats[nmat].solve = 1;
+    nmat++;
+
+    m = quick ? 12 : 20;
+    snprintf(mats[nmat].name, sizeof(mats[nmat].name), "poisson3d_%d", m);
+    itsol_gen_poisson(m, m, m, &mats[nmat].A);
+    mats[nmat].solve = 1;
+    nmat++;
+
+    m = quick ? 20 : 40;
+    snprintf(mats[nmat].name, sizeof(mats[nmat].name), "block2d_%d_dof4", m);
+    itsol_gen_block(m, m, 1, 4, 0.1, &mats[nmat].A);
+    mats[nmat].solve = !quick;
+    nmat++;
+
+    if (out == NULL) {
+        fp = stdout;
+    }
+    else if ((fp = fopen(out, "w")) == NULL) {
+        fprintf(stderr, "cannot open %s\n", out);
+        return 1;
+    }
+
+    fprintf(fp, "{\n  \"benchmark\": \"itsol\",\n  \"time\": %ld,\n  \"reps\": %d,\n", (long)time(NULL), reps);
+    fprintf(fp, "  \"omp_num_threads\": \"%s\",\n", getenv("OMP_NUM_THREADS") ? getenv("OMP_NUM_THREADS") : "");
+
+    fprintf(fp, "  \"matrices\": [");
+    for (i = 0; i < nmat; i++)
+        fprintf(fp, "%s\n    {\"name\": \"%s\", \"n\": %d, \"nnz\": %" ITS_INT_FMT "}", i ? "," : "", mats[i].name,
+                mats[i].A.n, mats[i].A.nnz);
+    fprintf(fp, "\n  ],\n");
+
+    fprintf(fp, "  \"kernels\": [");
+    first = 1;
+    for (i = 0; i < nmat; i++) {
+        fprintf(stderr, "kernels: %s\n", mats[i].name);
+        bench_kernels_(fp, &mats[i], reps, &first);
+    }
+    fprintf(fp, "\n  ],\n");
+
+    fprintf(fp, "  \"solves\": [");
+    first = 1;
+    for (i = 0; i < nmat; i++) {
+        if (!mats[i].solve) continue;
+
+        fprintf(stderr, "solves: %s\n", mats[i].name);
+        for (pc = ITS_PC_NONE; pc <= ITS_PC_PARILU; pc++)
+            for (st = ITS_SOLVER_FGMRES; st <= ITS_SOLVER_PGMRES; st++)
+                bench_solve_(fp, &mats[i], pc, st, reps, &first);
+    }
+    fprintf(fp, "\n  ]\n}\n");
+
+    if (fp != stdout) fclose(fp);
+    fclose(null_);
+
+    for (i = 0; i < nmat; i++) itsol_cleanCOO(&mats[i].A);
+
+    return 0;
+}
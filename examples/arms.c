@@ -12,7 +12,7 @@ int main(void)
 {
     int ierr = 0;
 
-    int nnz = 0;
+    ITS_INT nnz = 0;
 
     /*-------------------- main structs and wraper structs.     */
     ITS_SparMat *csmat = NULL;         /* matrix in csr formt             */
@@ -0,0 +1,81 @@
+#include "itsol.h"
+
+/*----------------------------------------------------------------------
+  | coo2bin in out
+  |----------------------------------------------------------------------
+  | converts a matrix read by itsol_read_coo (.coo, 0-based) or a Matrix
+  | Market coordinate file (1-based, general or symmetric) to the binary
+  | format read by itsol_read_bin.
+  +---------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    FILE *fp;
+    char str[ITS_MAX_LINE];
+    int mm = 0, sym = 0, ierr;
+    ITS_INT k, nnz;
+    ITS_CooMat A;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s matrix.coo|matrix.mtx matrix.bin\n", argv[0]);
+        return 1;
+    }
+
+    /* Matrix Market banner */
+    if ((fp = fopen(argv[1], "r")) == NULL) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    if (fgets(str, ITS_MAX_LINE, fp) != NULL && strncmp(str, "%%MatrixMarket", 14) == 0) {
+        mm = 1;
+        sym = strstr(str, "symmetric") != NULL;
+
+        if (strstr(str, "coordinate") == NULL || strstr(str, "pattern") != NULL
+                || strstr(str, "complex") != NULL || strstr(str, "hermitian") != NULL) {
+            fprintf(stderr, "%s: only real coordinate matrices are supported\n", argv[1]);
+            fclose(fp);
+            return 1;
+        }
+    }
+    fclose(fp);
+
+    A = itsol_read_coo(argv[1]);
+
+    if (mm) {
+        for (k = 0; k < A.nnz; k++) {
+            A.ia[k]--;
+            A.ja[k]--;
+        }
+    }
+
+    /* lower triangle only: add the mirrored off-diagonal entries */
+    if (sym) {
+        nnz = A.nnz;
+        for (k = 0; k < A.nnz; k++)
+            if (A.ia[k] != A.ja[k]) nnz++;
+
+        A.ia = (int *)realloc(A.ia, nnz * sizeof(int));
+        A.ja = (int *)realloc(A.ja, nnz * sizeof(int));
+        A.ma = (double *)realloc(A.ma, nnz * sizeof(double));
+
+        nnz = A.nnz;
+        for (k = 0; k < A.nnz; k++) {
+            if (A.ia[k] == A.ja[k]) continue;
+
+            A.ia[nnz] = A.ja[k];
+            A.ja[nnz] = A.ia[k];
+            A.ma[nnz] = A.ma[k];
+            nnz++;
+        }
+        A.nnz = nnz;
+    }
+
+    if ((ierr = itsol_write_bin(argv[2], &A)) != 0)
+        fprintf(stderr, "cannot write %s (%d)\n", argv[2], ierr);
+    else
+        printf("%s: n = %d, nnz = %" ITS_INT_FMT "\n", argv[2], A.n, A.nnz);
+
+    itsol_cleanCOO(&A);
+
+    return ierr;
+}
@@ -13,7 +13,8 @@ int main(void)
 {
     int ierr = 0;
 
-    int dropmthd = DRP_MTH, nnz;
+    int dropmthd = DRP_MTH;
+    ITS_INT nnz;
     int pattern_symm = 0;
 
     /*-------------------- main structs and wraper structs.     */
@@ -18,7 +18,8 @@ int main(void)
     ITS_ILUSpar *lu = NULL;     /* ilu preconditioner structure    */
     double *sol = NULL, *x = NULL, *rhs = NULL;
 
-    int n, nnz, lfil;
+    int n, lfil;
+    ITS_INT nnz;
     int i;
     double terr, norm;
     ITS_PARS io;
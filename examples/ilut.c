@@ -21,7 +21,8 @@ int main(void)
     ITS_ILUSpar *lu = NULL;           /* ilu preconditioner structure    */
     double *sol = NULL, *x = NULL, *rhs = NULL;
 
-    int n, nnz;
+    int n;
+    ITS_INT nnz;
     ITS_PARS io;
     int i;
     double terr, norm;
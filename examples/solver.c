@@ -8,7 +8,8 @@ int main(void)
 {
 
     double *sol = NULL, *x = NULL, *rhs = NULL;
-    int n, nnz;
+    int n;
+    ITS_INT nnz;
     int i, ierr;
     double terr, norm;
     ITS_CooMat A;
@@ -23,7 +23,8 @@ int main(void)
     ITS_PC *PRE;                       /* general precond structure       */
     double *sol = NULL, *x = NULL, *prhs = NULL, *rhs = NULL;
 
-    int n, nnz;
+    int n;
+    ITS_INT nnz;
 
     /*-------------------- IO */
     ITS_PARS io;
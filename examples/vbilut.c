@@ -19,7 +19,8 @@ int main(void)
     double *sol = NULL, *x = NULL, *prhs = NULL, *rhs = NULL;
 
     /*---------------------------------------------------------*/
-    int n, nnz;
+    int n;
+    ITS_INT nnz;
     ITS_BData *w = NULL;
     int lfil, max_blk_sz = ITS_MAX_BLOCK_SIZE * ITS_MAX_BLOCK_SIZE * sizeof(double);
     int nBlock, *nB = NULL, *perm = NULL;
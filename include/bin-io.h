@@ -0,0 +1,43 @@
+#ifndef ITSOL_BIN_IO_H__
+#define ITSOL_BIN_IO_H__
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------
+  | binary matrix files
+  |----------------------------------------------------------------------
+  | A header followed by the arrays of the matrix, in the byte order and
+  | int size of the machine that wrote the file:
+  |
+  |   magic    8 bytes, "ITSOLMAT"
+  |   version  int32, ITS_BIN_VERSION
+  |   endian   int32, 0x01020304 as written
+  |   kind     int32, ITS_BIN_COO
+  |   isize    int32, sizeof(int)
+  |   n, nnz   int64
+  |   off_ma, off_ia, off_ja   int64, byte offsets of the arrays
+  |
+  | The arrays are those of ITS_CooMat (0-based indices) and start on
+  | ITS_BIN_ALIGN byte boundaries, so that they can be used straight
+  | from a file mapping.
+  +---------------------------------------------------------------------*/
+#define ITS_BIN_VERSION  1
+#define ITS_BIN_COO      0
+#define ITS_BIN_ALIGN    64
+
+int itsol_write_bin(char *fname, ITS_CooMat *A);
+int itsol_read_bin(char *fname, ITS_CooMat *A);
+int itsol_unmap_bin(ITS_CooMat *A);
+
+/* assembled preconditioners, see bin-io.c for the layout */
+int itsol_pc_save(ITS_PC *pc, char *fname);
+int itsol_pc_load(ITS_PC *pc, char *fname);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -7,13 +7,50 @@
 #include <math.h>
 #include <time.h>
 #include <assert.h> 
+#include <stdint.h>
+#include <inttypes.h>
+#include <limits.h>
 
 #include "config.h"
 #include "protos-deps.h"
 
+/*---------------------------------------------
+  | type of nonzero counts, offsets into arrays
+  | of all the nonzeros (COO entries, flat CSR
+  | storage) and work space lengths. 32 bit by
+  | default, 64 bit when built with ITSOL_INT64
+  | so that matrices and factors may hold more
+  | than INT_MAX nonzeros. Row and column indices
+  | stay int: the dimension is < INT_MAX either way.
+  |---------------------------------------------*/
+#ifdef ITSOL_INT64
+typedef int64_t ITS_INT;
+#define ITS_INT_MAX          INT64_MAX
+#define ITS_INT_FMT          PRId64
+#define ITS_INT_SCN          SCNd64
+#else
+typedef int ITS_INT;
+#define ITS_INT_MAX          INT_MAX
+#define ITS_INT_FMT          "d"
+#define ITS_INT_SCN          "d"
+#endif
+
 #define ITS_MAX_BLOCK_SIZE   100
 #define ITS_TOL_DD           0.7  /* diagonal dominance tolerance for arms */
 
+/* ITS_PARS.perm_type: orderings applied before the ILU factorizations */
+#define ITS_PERM_NONE        0    /* natural order (indset perms for ARMS) */
+#define ITS_PERM_MC          2    /* multicoloring, itsol_mcolor          */
+#define ITS_PERM_RCM         3    /* reverse Cuthill-McKee, itsol_rcm     */
+#define ITS_PERM_AMD         4    /* approximate min. degree, itsol_amd   */
+#define ITS_PERM_ND          5    /* nested dissection, itsol_nd          */
+
+/* threaded kernels (ITSOL_USE_OPENMP): smaller problems run serially */
+#define ITS_OMP_MIN_NNZ      20000  /* nonzeros, matvec family          */
+#define ITS_OMP_MIN_ROWS     4000   /* rows / vector length             */
+#define ITS_OMP_ROW_CHUNK    256    /* rows per dynamically scheduled chunk */
+#define ITS_OMP_LEVEL_ROWS   64     /* mean rows per level, level-scheduled solves */
+
 /* FORTRAN style vblock format, compatible for many FORTRAN routines */
 #define ITS_DATA(a,row,i,j)  (a[(j)*(row)+(i)])
 
@@ -25,9 +62,33 @@
 #define ITS_MAX_MAT	        100
 #define ITS_MaxNamLen       64
 
+/*---------------------------------------------
+  | level schedule of a triangular factor: rows
+  | of one level only depend on rows of lower
+  | levels and are solved in parallel.
+  | rows[lev[l]] .. rows[lev[l+1]-1] = level l
+  |---------------------------------------------*/
+typedef struct ITS_LevSched_
+{
+    int nlev;     /* number of levels                 */
+    int *lev;     /* first entry of each level (nlev+1) */
+    int *rows;    /* rows sorted by level             */
+
+} ITS_LevSched;
+
 /*--------------------------------------------- 
   | C-style CSR format - used internally
   | for all matrices in CSR format 
+  |
+  | rows are stored either separately (ia == NULL)
+  | or in flat storage: jflat/mflat hold all the
+  | rows one after the other, row i starts at
+  | ia[i] and ja[i], ma[i] point into jflat, mflat.
+  | ja[i], ma[i] are valid in both cases.
+  |
+  | values in single precision (itsol_csfloat):
+  | ma == NULL and fa[i] holds the values of
+  | row i, inside fflat in flat storage.
   |---------------------------------------------*/
 typedef struct ITS_SparMat_
 {
@@ -36,18 +97,55 @@ typedef struct ITS_SparMat_
     int **ja;      /* pointer-to-pointer to store column indices  */
     double **ma;   /* pointer-to-pointer to store nonzero entries */
 
+    ITS_INT *ia;   /* row pointers (n+1) in flat storage, or NULL */
+    int *jflat;    /* column indices of all rows (flat storage)   */
+    double *mflat; /* nonzero entries of all rows (flat storage)  */
+
+    float **fa;    /* single precision entries of each row, or NULL */
+    float *fflat;  /* single precision entries, flat storage        */
+
+    ITS_LevSched *sched; /* level schedule of a triangular factor, or NULL */
+
 } ITS_SparMat;
 
 typedef struct ITS_CooMat_
 {
     int n;
-    int nnz;      /* length of each row */
+    ITS_INT nnz;  /* number of entries */
     int *ia;      /* pointer-to-pointer to store column indices  */
     int *ja;      /* pointer-to-pointer to store column indices  */
     double *ma;   /* pointer-to-pointer to store nonzero entries */
 
+    void *map;    /* file mapping holding ia, ja, ma (itsol_read_bin), or NULL */
+    size_t maplen;
+
 } ITS_CooMat;
 
+/*---------------------------------------------
+  | sliced ELLPACK (SELL-C-sigma) format, used
+  | for matrix-vector products only.
+  | rows are sorted by decreasing length inside
+  | windows of sigma rows, then cut into slices
+  | of ITS_SELL_C rows padded to the longest row
+  | of the slice. Entry k of the r-th row of
+  | slice s is stored at sptr[s] + k * C + r,
+  | padding has column 0 and value 0.
+  |---------------------------------------------*/
+#define ITS_SELL_C           8    /* slice height = doubles per AVX-512 vector */
+
+typedef struct ITS_SellMat_
+{
+    int n;
+    int sigma;    /* sorting window                            */
+    int nslices;  /* number of slices                          */
+    ITS_INT *sptr; /* first entry of each slice (nslices+1)    */
+    int *slen;    /* width (padded row length) of each slice   */
+    int *rows;    /* original row in each slot, -1 for padding */
+    int *ja;      /* column indices, slice by slice            */
+    double *ma;   /* nonzero entries, slice by slice           */
+
+} ITS_SellMat;
+
 typedef double *ITS_BData;
 
 typedef struct ITS_VBSparMat_
@@ -60,6 +158,9 @@ typedef struct ITS_VBSparMat_
     int **ja;         /* pointer-to-pointer to store column indices */
     ITS_BData **ba;   /* pointer-to-pointer to store nonzero blocks */
     ITS_BData *D;     /* to store inversion of diagonals            */
+    float **fa;       /* single precision blocks (itsol_vbfloat): all
+                         blocks of row i one after the other in fa[i],
+                         ba == NULL then; or NULL                   */
 
 } ITS_VBSparMat;
 
@@ -87,6 +188,12 @@ typedef struct ITS_ILUSpar_
     double *D;        /* diagonal elements                          */
     ITS_SparMat *U;   /* U part elements                            */
     int *work;        /* working buffer */
+    int nsweep;       /* > 0: solves by nsweep Jacobi sweeps        */
+    double *swk;      /* 2n scratch of the sweeps, or NULL          */
+    int ndom;         /* > 1: rows dom[d] .. dom[d+1]-1 are diagonal */
+    int *dom;         /* blocks not coupled to each other (nested
+                         dissection), factored in parallel; the rows
+                         from dom[ndom] on come after them           */
 
 } ITS_ILUSpar;
 
@@ -130,6 +237,8 @@ typedef struct ITS_Per4Mat_
     double *D1 ;      /* diagonal scaling row    */  
     double *D2 ;      /* diagonal scaling columns*/  
     double *wk;       /* work array              */
+    int nblk;         /* diagonal blocks of L, U: rows blk[d] .. */
+    int *blk;         /* blk[d+1]-1, or NULL (itsol_diagblocks)  */
 
     /* pointer to next and previous struct         */
     struct ITS_Per4Mat_ *prev; 
@@ -200,15 +309,46 @@ typedef struct ITS_CompressType
 
 } ITS_CompressType;
 
+/*---------------------------------------------
+  | timings (seconds, wall clock) and counters
+  | of an ITS_SOLVER. The setup entries are those
+  | of the last (re)factorization, the solve
+  | entries add up over the solves until the
+  | struct is zeroed.
+  |---------------------------------------------*/
+typedef struct ITS_STATS_
+{
+    /* itsol_solver_assemble, itsol_pc_assemble, itsol_solver_update_values */
+    double t_coo;      /* COO -> CSR conversion                          */
+    double t_order;    /* reordering / blocking before the factorization */
+    double t_symb;     /* symbolic factorization (ILUK)                  */
+    double t_num;      /* numeric factorization (all of it but for ILUK) */
+    ITS_INT nnz_pc;    /* nonzeros of the preconditioner                 */
+
+    /* itsol_solver_solve, itsol_solver_solve_block */
+    int nsolve;        /* right hand sides solved                        */
+    double t_solve;    /* time in the iterative solvers                  */
+    double t_matvec;   /* time in matrix-vector products                 */
+    double t_precon;   /* time in preconditioner applies                 */
+    long nmatvec;      /* matrix-vector products (per vector)            */
+    long nprecon;      /* preconditioner applies (per vector)            */
+    long ndot;         /* inner products and norms (per vector)          */
+
+} ITS_STATS;
+
 /*-------------------- 3 types of matrices so far */
 typedef struct ITS_SMat
 {
     int n; 
-    int Mtype;             /*--  type 1 = CSR, 2 = VBCSR, 3 = LDU    */
+    int Mtype;             /*--  type 1 = CSR, 2 = VBCSR, 3 = LDU, 4 = SELL */
     ITS_SparMat *CS;       /* place holder for a CSR/CSC type matrix */
     ITS_ILUSpar *LDU;      /* struct for an LDU type matrix          */
     ITS_VBSparMat *VBCSR;  /* place holder for a block matrix        */
+    ITS_SellMat *SELL;     /* SELL-C-sigma copy of a CSR matrix      */
     void (*matvec)(struct ITS_SMat*, double *, double *);
+    /* p vectors stored interleaved, x[i * p + j]; NULL if not available */
+    void (*matvec_mv)(struct ITS_SMat*, int, double *, double *);
+    ITS_STATS *stats;      /* solve counters, or NULL                */
 
 } ITS_SMat;
 
@@ -222,6 +362,7 @@ typedef enum ITS_PC_TYPE_
     ITS_PC_ILUC,
     ITS_PC_VBILUK,
     ITS_PC_VBILUT,
+    ITS_PC_PARILU,
 
 } ITS_PC_TYPE;
 
@@ -231,6 +372,8 @@ typedef enum ITS_SOLVER_TYPE_
     ITS_SOLVER_FGMRES,
     ITS_SOLVER_BICGSTAB,
     ITS_SOLVER_BICGSTABL,
+    ITS_SOLVER_BFGMRES,         /* FGMRES on p right-hand-sides at once */
+    ITS_SOLVER_PGMRES,          /* pipelined GMRES, one reduction a step */
 
 } ITS_SOLVER_TYPE;
 
@@ -244,7 +387,12 @@ typedef struct ITS_PC
     ITS_VBILUSpar *VBILU;  /* struct for a block preconditioner */
     int *perm;
 
+    double *wk;            /* scratch of the apply, itsol_pc_worksize
+                              doubles; NULL: the buffers of the factors */
+
     int (*precon) (double *, double *, struct ITS_PC *); 
+    /* p vectors stored interleaved; NULL: precon applied column by column */
+    int (*precon_mv) (int, double *, double *, struct ITS_PC *);
     FILE *log;
 
 } ITS_PC;
@@ -265,11 +413,27 @@ typedef struct ITS_PARS_
     int iluk_level;             /* level of fill for ILUK  */
     int milu;                     /* modified ILU, added to original ITSOL  */
     /* vbilu value always set to 1           */
-    int perm_type;               /* indset perms (0) or PQ perms (1)*/
+    int perm_type;               /* ARMS: indset perms (0) or PQ perms
+                                    (1). ILUK, ILUT, PARILU: ordering
+                                    of A, ITS_PERM_*               */
     int Bsize;                   /* block size - dual role */
 
     int diagscal;
     double tolind;
+    int csflat;                  /* flat CSR storage (1) or row by row (0) */
+    int sell_sigma;              /* matvecs in SELL-C-sigma format with this
+                                    sorting window (> 0), CSR (0)  */
+    int pc_float;                /* factor values stored in single
+                                    precision (1) or double (0)    */
+    int pc_sweeps;               /* ILU solves by this many Jacobi
+                                    sweeps (> 0) or exact (0)      */
+    int parilu_sweeps;           /* fixed-point sweeps of PARILU, on
+                                    the ILUK pattern of iluk_level */
+    int nd_level;                /* ITS_PERM_ND: levels of dissection,
+                                    up to 2^nd_level subdomains    */
+    int indset_nchunk;           /* ARMS independent sets: built on
+                                    this many graph slabs in parallel
+                                    (> 1) or serially (0)          */
     int lfil_arr[7];
     double droptol[7], dropcoef[7];
     int ipar[18];
@@ -279,6 +443,20 @@ typedef struct ITS_PARS_
 
 } ITS_PARS;
 
+/*---------------------------------------------
+  | work space kept across solves: grown on
+  | demand by itsol_getWORK / itsol_getWORKvec,
+  | released by itsol_cleanWORK.
+  |---------------------------------------------*/
+typedef struct ITS_WORK_
+{
+    double *buf;      /* work vectors                */
+    ITS_INT len;      /* allocated length of buf     */
+    double **vec;     /* arrays of vector pointers   */
+    int nvec;         /* allocated length of vec     */
+
+} ITS_WORK;
+
 typedef struct ITS_SOLVER_
 {
     ITS_SOLVER_TYPE s_type;
@@ -287,6 +465,8 @@ typedef struct ITS_SOLVER_
     /* internal mat */
     ITS_SMat smat;           /* Matrix structure for matvecs    */
     ITS_SparMat *csmat;
+    int *cmap;               /* slot of each COO entry in its csmat row,
+                                for itsol_solver_update_values  */
 
     ITS_PC_TYPE pc_type;
     ITS_PC pc;               /* general precond structure       */
@@ -297,6 +477,10 @@ typedef struct ITS_SOLVER_
     int nits;
     double res;
     int assembled;
+    ITS_STATS stats;         /* timings and counters            */
+
+    ITS_WORK work;           /* iterative solver work vectors    */
+    ITS_WORK pwork;          /* permuted rhs and solution        */
 
 } ITS_SOLVER;
 
@@ -45,6 +45,16 @@ int itsol_PQperm(ITS_SparMat *mat, int bsize, int *Pord, int *Qord, int *nnod, d
 int itsol_indsetC(ITS_SparMat *mat, int bsize, int *iord, int *nnod, double tol);
 int itsol_weightsC(ITS_SparMat *mat, double *w);
 
+/*---------------------------------------------------------------------
+| parallel variant of itsol_indsetC, same arguments and output: the
+| graph is cut into nchunk slabs of a breadth first order, the nodes
+| coupled to a later slab go to the complement, then each slab is
+| blocked as in itsol_indsetC, the slabs in parallel. Falls back to
+| itsol_indsetC when the slab boundaries hold too many nodes. The
+| result depends on nchunk only, not on the number of threads.
+|--------------------------------------------------------------------*/
+int itsol_indsetC_par(ITS_SparMat *mat, int bsize, int *iord, int *nnod, double tol, int nchunk);
+
 /*---------------------------------------------------------------------
 | does a preselection of possible diagonal entries. will return a list
 | of "count" bi-indices representing "good" entries to be selected as 
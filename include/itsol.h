@@ -5,9 +5,16 @@
 #include "solver-fgmres.h"
 #include "solver-bicgstab.h"
 #include "solver-bicgstabl.h"
+#include "solver-bfgmres.h"
+#include "solver-pgmres.h"
+
+#include "bin-io.h"
+#include "matgen.h"
+#include "ordering.h"
 
 #include "pc-arms2.h"
 #include "pc-iluk.h"
+#include "pc-parilu.h"
 #include "pc-ilutc.h"
 #include "pc-ilut.h"
 #include "pc-ilutpc.h"
@@ -23,12 +30,22 @@ void itsol_solver_initialize(ITS_SOLVER *s, ITS_SOLVER_TYPE stype, ITS_PC_TYPE p
 void itsol_solver_finalize(ITS_SOLVER *s);
 
 int itsol_solver_assemble(ITS_SOLVER *s);
+int itsol_solver_update_values(ITS_SOLVER *s, double *a);
+int itsol_solver_save_pc(ITS_SOLVER *s, char *fname);
+int itsol_solver_load_pc(ITS_SOLVER *s, char *fname);
 
 int itsol_solver_solve(ITS_SOLVER *s, double *x, double *rhs);
+int itsol_solver_solve_ws(ITS_SOLVER *s, double *x, double *rhs, ITS_WORK *work, ITS_WORK *pwork,
+        int *nits, double *res);
+int itsol_solver_solve_block(ITS_SOLVER *s, int p, double *X, double *B);
+void itsol_solver_print_stats(ITS_SOLVER *s, FILE *fp);
 
 void itsol_pc_initialize(ITS_PC *pc, ITS_PC_TYPE pctype);
 void itsol_pc_finalize(ITS_PC *pc);
 int itsol_pc_assemble(ITS_SOLVER *s);
+int itsol_pc_worksize(ITS_PC *pc);
+int itsol_pc_float(ITS_PC *pc);
+int itsol_pc_sweeps(ITS_PC *pc, int nsweep);
 
 void itsol_solver_set_pars(ITS_SOLVER *s, ITS_PARS par);
 void itsol_solver_init_pars(ITS_PARS *par);
@@ -47,12 +47,19 @@ void itsol_amxpby(double a, ITS_SparMat *A, double *x, double b, double *y);
 void itsol_amxpbyz(double a, ITS_SparMat *A, double *x, double b, double *y, double *z); 
 
 void itsol_matvecCSR(ITS_SMat *mat, double *x, double *y);
+
+/* Y = AX for p vectors stored interleaved, x[i * p + j] */
+void itsol_matvec_mv(ITS_SparMat *A, int p, double *x, double *y);
+void itsol_matvecCSR_mv(ITS_SMat *mat, int p, double *x, double *y);
 void itsol_matvecz(ITS_SparMat *mata, double *x, double *y, double *z);
 
 void itsol_vbmatvec(ITS_VBSparMat *vbmat, double *x, double *y);
 void itsol_luinv(int n, double *a, double *x, double *y); 
 int itsol_vblusolC(double *y, double *x, ITS_VBILUSpar *lu); 
+int itsol_vblusolC_r(double *y, double *x, ITS_VBILUSpar *lu, double *bf);
 int itsol_lusolC(double *y, double *x, ITS_ILUSpar *lu); 
+int itsol_lusolC_r(double *y, double *x, ITS_ILUSpar *lu, double *work);
+int itsol_lusolC_mv(int p, double *y, double *x, ITS_ILUSpar *lu);
 int itsol_rpermC(ITS_SparMat *mat, int *perm); 
 int itsol_cpermC(ITS_SparMat *mat, int *perm) ; 
 int itsol_dpermC(ITS_SparMat *mat, int *perm) ; 
@@ -63,15 +70,25 @@ void itsol_Usol(ITS_SparMat *mata, double *b, double *x);
 int itsol_ascend (ITS_Per4Mat *levmat, double *x, double *wk);
 int itsol_descend(ITS_Per4Mat *levmat, double *x, double *wk);
 int itsol_armsol2(double *x, ITS_ARMSpar *Prec);
+int itsol_armsol2_r(double *x, ITS_ARMSpar *Prec, double *work);
 int itsol_condestArms(ITS_ARMSpar *armspre, double *y, FILE *fp);
 int itsol_VBcondestC(ITS_VBILUSpar *, FILE *fp); 
 int itsol_CondestLUM(ITS_ILUSpar *lu, double *y, double *x, FILE *fp);
 void itsol_matvecVBR(ITS_SMat *mat, double *x, double *y);
+void itsol_matvecSELL(ITS_SMat *mat, double *x, double *y);
+
+/* part t of nt of y = A x (CSR, SELL) for the threads of a parallel
+   region, 1 when the matvec of mat has no such split */
+int itsol_matvec_part(ITS_SMat *mat, double *x, double *y, int t, int nt);
 void itsol_matvecLDU(ITS_SMat *mat, double *x, double *y);
 int itsol_preconILU(double *x, double *y, ITS_PC *mat);
+int itsol_preconILU_mv(int p, double *x, double *y, ITS_PC *mat);
 int itsol_preconVBR(double *x, double *y, ITS_PC *mat);
 int itsol_preconLDU(double *x, double *y, ITS_PC *mat);
 int itsol_preconARMS(double *x, double *y, ITS_PC *mat);
+/* matvec / precon of the solvers, timed and counted in Amat->stats */
+void itsol_matvec_st(ITS_SMat *Amat, double *x, double *y);
+int itsol_precon_st(ITS_SMat *Amat, ITS_PC *lu, double *x, double *y);
 ITS_Per4Mat *itsol_Lvsol2(double *x, int nlev, ITS_Per4Mat *levmat, ITS_ILUTSpar * ilusch) ;
 int itsol_Uvsol2(double *x, int nlev, int n, ITS_Per4Mat *levmat, ITS_ILUTSpar * ilusch); 
 void itsol_SchLsol(ITS_ILUTSpar * ilusch, double *y) ;
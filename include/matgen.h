@@ -0,0 +1,44 @@
+#ifndef ITSOL_MATGEN_H__
+#define ITSOL_MATGEN_H__
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------
+  | test matrices on nx x ny x nz grids
+  |----------------------------------------------------------------------
+  | Finite differences on a grid of mesh width h = 1 / (nx + 1) in every
+  | direction, Dirichlet boundaries, scaled by h^2. The y or z direction
+  | is dropped when it has a single grid point: nz = 1 gives 5-point
+  | matrices in 2D, ny = nz = 1 3-point matrices in 1D. Unknowns are numbered x first,
+  | then y, then z (then the dof at each grid point for
+  | itsol_gen_block); the entries of A come row by row, 0-based, and A
+  | is released by itsol_cleanCOO.
+  |
+  | return 0 on success, 1 if a size is < 1, 2 if the matrix is too
+  | large for the index types (ITS_INT nonzeros, int rows).
+  +---------------------------------------------------------------------*/
+
+/* -laplace(u) */
+int itsol_gen_poisson(int nx, int ny, int nz, ITS_CooMat *A);
+
+/* -(kx u_xx + ky u_yy + kz u_zz) */
+int itsol_gen_aniso(int nx, int ny, int nz, double kx, double ky, double kz, ITS_CooMat *A);
+
+/* -laplace(u) + pe (bx u_x + by u_y + bz u_z), central differences or
+   first order upwind (upwind != 0) for the convection */
+int itsol_gen_convdiff(int nx, int ny, int nz, double pe, double bx, double by, double bz,
+        int upwind, ITS_CooMat *A);
+
+/* dof unknowns per grid point: each coefficient c of the Poisson
+   stencil becomes the dof x dof block with c on the diagonal and
+   cpl * c off it */
+int itsol_gen_block(int nx, int ny, int nz, int dof, double cpl, ITS_CooMat *A);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,47 @@
+#ifndef ITSOL_ORDERING_H__
+#define ITSOL_ORDERING_H__
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------
+  | symmetric orderings of a matrix in SpaFmt format, applied before the
+  | ILU factorizations (ITS_PARS.perm_type, see itsol_pc_assemble).
+  |----------------------------------------------------------------------
+  | They work on the graph of A + A^T (the values are not used) and
+  | return perm: row / column i becomes perm[i], as for itsol_dpermC.
+  |
+  | itsol_mcolor: greedy multicoloring, the colors one after the other.
+  |     Nodes of one color are not connected, so the rows of a color
+  |     form a diagonal block and are factored and solved in parallel.
+  |     ncolor = number of colors.
+  |
+  | itsol_rcm: reverse Cuthill-McKee, from a pseudo-peripheral node of
+  |     each connected component. Reduces the bandwidth, so that the
+  |     x[ja[k]] of the matvecs and triangular solves stay close to row
+  |     i, and the fill of the ILU factors.
+  |
+  | itsol_amd: approximate minimum degree, reduces the fill of ILUK with
+  |     level >= 1 and the size of the ILUT factors for a given
+  |     threshold (see ITS_STATS.nnz_pc).
+  |
+  | itsol_nd: nested dissection, nlev levels of bisection. The ndom
+  |     subdomains come first, rows (*dom)[d] .. (*dom)[d+1]-1 (dom is
+  |     allocated here, ndom+1 entries), then the separators. The
+  |     subdomains are not coupled, so their rows are factored in
+  |     parallel (ITS_ILUSpar.dom).
+  |
+  | return 0 on success.
+  |--------------------------------------------------------------------*/
+int itsol_mcolor(ITS_SparMat *mat, int *perm, int *ncolor);
+int itsol_rcm(ITS_SparMat *mat, int *perm);
+int itsol_amd(ITS_SparMat *mat, int *perm);
+int itsol_nd(ITS_SparMat *mat, int nlev, int *perm, int *ndom, int **dom);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -49,7 +49,11 @@ extern "C" {
 |       ipar[3]:=iout   if (iout > 0) statistics on the run are 
 |                       printed to FILE *ft
 |
-|       ipar[4-9] NOT used [reserved for later use] - set to zero.
+|       ipar[4]:=nchunk if (nchunk > 1) and ipar[1] == 0 the independent
+|                       sets are built on nchunk graph slabs in parallel,
+|                       see itsol_indsetC_par.
+|
+|       ipar[5-9] NOT used [reserved for later use] - set to zero.
 | 
 | The following set method options for arms2. Their default values can
 | all be set to zero if desired. 
@@ -10,6 +10,10 @@ extern "C" {
 
 int itsol_pc_lofC(int lofM, ITS_SparMat *csmat, ITS_ILUSpar *lu, FILE *fp); 
 int itsol_pc_ilukC(int lofM, ITS_SparMat *csmat, ITS_ILUSpar *lu, int milu, FILE *fp);
+int itsol_pc_ilukC_symb(int lofM, ITS_SparMat *csmat, ITS_ILUSpar *lu, FILE *fp);
+int itsol_pc_ilukC_symb_nd(int lofM, ITS_SparMat *csmat, ITS_ILUSpar *lu, int ndom, int *dom,
+        FILE *fp);
+int itsol_pc_ilukC_num(ITS_SparMat *csmat, ITS_ILUSpar *lu, int milu, FILE *fp);
 
 #ifdef __cplusplus
 }
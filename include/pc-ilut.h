@@ -60,6 +60,11 @@ extern "C" {
  *--------------------------------------------------------------------------*/
 int itsol_pc_ilut(ITS_SparMat *csmat, ITS_ILUSpar *lu, int lfil, double tol, FILE *fp);
 
+/* the same, rows dom[d] .. dom[d+1]-1 (d < ndom) in independent diagonal
+   blocks factored in parallel, see itsol_nd */
+int itsol_pc_ilut_nd(ITS_SparMat *csmat, ITS_ILUSpar *lu, int lfil, double tol, int ndom,
+        int *dom, FILE *fp);
+
 int itsol_pc_lutsolC(double *y, double *x, ITS_ILUSpar *lu);
 
 #ifdef __cplusplus
@@ -0,0 +1,17 @@
+
+#ifndef ITSOL_PARILU_H__
+#define ITSOL_PARILU_H__
+
+#include "pc-iluk.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int itsol_pc_parilu(int lofM, int nsweep, ITS_SparMat *csmat, ITS_ILUSpar *lu, FILE *fp);
+int itsol_pc_parilu_num(int nsweep, ITS_SparMat *csmat, ITS_ILUSpar *lu, FILE *fp);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
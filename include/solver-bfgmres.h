@@ -0,0 +1,42 @@
+#ifndef ITSOL_BFGMRES_H__
+#define ITSOL_BFGMRES_H__
+
+#include "mat-utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------
+|       *** Preconditioned FGMRES, p right-hand-sides at once ***
++-----------------------------------------------------------------------
+| on entry:
+|----------
+|
+|(Amat)   = matrix struct. the product with p vectors is
+|           Amat->matvec_mv, or Amat->matvec column by column if NULL.
+|(lu)     = preconditioner struct.. the preconditioner is lu->precon_mv,
+|           or lu->precon column by column if NULL.
+|           if (lu == NULL) the no-preconditioning option is invoked.
+| p       = number of right hand sides.
+| rhs     = p real vectors of length n, stored interleaved: entry i of
+|           vector j is rhs[i * p + j].
+| sol     = p initial guesses, stored as rhs.
+| ws      = work space (NULL: allocated for this call).
+|
+| on return:
+|----------
+| bfgmr     int =  0 --> successful return.
+|           int =  1 --> convergence not achieved in itmax iterations
+|                        for at least one of the right hand sides.
+| sol     = contains the approximate solutions.
+| nits    = number of steps -- of the slowest right hand side
+| res     = largest residual norm among the right hand sides.
++---------------------------------------------------------------------*/
+int itsol_solver_bfgmres(ITS_SMat *Amat, ITS_PC *lu, int p, double *rhs, double *sol, ITS_PARS io,
+        int *nits, double *res, ITS_WORK *ws);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
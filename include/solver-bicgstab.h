@@ -2,7 +2,7 @@
 #ifndef ITSOL_BICGSTAB_H__
 #define ITSOL_BICGSTAB_H__
 
-#include "utils.h"
+#include "mat-utils.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,6 +37,10 @@ extern "C" {
 int itsol_solver_bicgstab(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
         int *nits, double *res);
 
+/* same, with the work vectors taken from ws (NULL: allocated per call) */
+int itsol_solver_bicgstab_ws(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
+        int *nits, double *res, ITS_WORK *ws);
+
 #ifdef __cplusplus
 }
 #endif
@@ -37,6 +37,10 @@ extern "C" {
 int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
         int *nits, double *res);
 
+/* same, with the work vectors taken from ws (NULL: allocated per call) */
+int itsol_solver_bicgstabl_ws(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
+        int *nits, double *res, ITS_WORK *ws);
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,7 +2,7 @@
 #ifndef ITSOL_FGMRES_H__
 #define ITSOL_FGMRES_H__
 
-#include "utils.h"
+#include "mat-utils.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -44,6 +44,10 @@ extern "C" {
 int itsol_solver_fgmres(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
         int *nits, double *res);
 
+/* same, with the work arrays taken from ws (NULL: allocated per call) */
+int itsol_solver_fgmres_ws(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
+        int *nits, double *res, ITS_WORK *ws);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,57 @@
+#ifndef ITSOL_PGMRES_H__
+#define ITSOL_PGMRES_H__
+
+#include "mat-utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------
+|          *** Preconditioned pipelined GMRES, p(1)-GMRES ***
++-----------------------------------------------------------------------
+| One fused reduction a step. Threaded, it runs in the same parallel
+| region as the matvec that follows the preconditioning of the step;
+| the preconditioner itself is applied before, in its own regions.
+|
+| on entry:
+|----------
+|
+|(Amat)   = matrix struct. the matvec operation is Amat->matvec.
+|(lu)     = preconditioner struct.. the preconditioner is lu->precon
+|           if (lu == NULL) the no-preconditioning option is invoked.
+|           It must be the same linear operator at every step (right
+|           preconditioning, not flexible).
+| rhs     = real vector of length n containing the right hand side.
+| sol     = real vector of length n containing an initial guess to the
+|           solution on input.
+| ws      = work space (NULL: allocated for this call).
+|
+| on return:
+|----------
+| pgmr      int =  0 --> successful return.
+|           int =  1 --> convergence not achieved in itmax iterations.
+| sol     = contains an approximate solution (upon successful return).
+| nits    = number of steps required to converge.
+| res     = residual norm.
+|
+| restart, maxits and tol of io have the meaning they have for
+| itsol_solver_fgmres.
++-----------------------------------------------------------------------
+| internal work arrays:
+|----------
+| vv      = work array of length [im+1][n], the Arnoldi basis
+| zz      = work array of length [im+1][n], zz_{i+1} = A M^{-1} v_i
+| hh      = work array of length [im][im+1] (Arnoldi matrix)
++---------------------------------------------------------------------*/
+int itsol_solver_pgmres(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
+        int *nits, double *res);
+
+/* same, with the work arrays taken from ws (NULL: allocated per call) */
+int itsol_solver_pgmres_ws(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
+        int *nits, double *res, ITS_WORK *ws);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
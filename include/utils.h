@@ -9,20 +9,29 @@ extern "C" {
 #endif
 
 /* sets.c */
-int itsol_nnz_arms(ITS_ARMSpar *PreSt,  FILE *ft);
+ITS_INT itsol_nnz_arms(ITS_ARMSpar *PreSt,  FILE *ft);
 void itsol_errexit(char *f_str, ...);
-void * itsol_malloc(int nbytes, char *msg); 
+void * itsol_malloc(size_t nbytes, char *msg); 
 int itsol_setupCS(ITS_SparMat *amat, int len, int job); 
 int itsol_cleanCS(ITS_SparMat *amat);
+int itsol_csflat(ITS_SparMat *amat, int job);
+int itsol_csfloat(ITS_SparMat *amat);
+int itsol_levsched(ITS_SparMat *amat, int upper);
+void itsol_cleanLevSched(ITS_SparMat *amat);
+int itsol_diagblocks(ITS_SparMat *A, ITS_SparMat *B, int n, int *blk);
+double *itsol_getWORK(ITS_WORK *w, ITS_INT len);
+double **itsol_getWORKvec(ITS_WORK *w, int nvec);
+void itsol_cleanWORK(ITS_WORK *w);
 int itsol_cleanCOO(ITS_CooMat *amat);
-int itsol_nnz_cs (ITS_SparMat *A) ;
+ITS_INT itsol_nnz_cs (ITS_SparMat *A) ;
 int itsol_cscpy(ITS_SparMat *amat, ITS_SparMat *bmat);
 int itsol_setupP4 (ITS_Per4Mat *amat, int Bn, int Cn,  ITS_SparMat *F,  ITS_SparMat *E);
 int itsol_setupVBMat(ITS_VBSparMat *vbmat, int n, int *nB);
 int itsol_setupILUT(ITS_ILUTSpar * amat, int len);
 int itsol_cleanVBMat(ITS_VBSparMat *vbmat); 
-int itsol_nnzVBMat(ITS_VBSparMat *vbmat) ;
-int itsol_memVBMat(ITS_VBSparMat *vbmat); 
+ITS_INT itsol_nnzVBMat(ITS_VBSparMat *vbmat) ;
+ITS_INT itsol_memVBMat(ITS_VBSparMat *vbmat); 
+int itsol_vbfloat(ITS_VBSparMat *vbmat, int *bsz);
 int itsol_setupVBILU(ITS_VBILUSpar *lu, int n, int *bsz);
 int itsol_cleanVBILU(ITS_VBILUSpar *lu); 
 int itsol_cleanILU(ITS_ILUSpar *lu);
@@ -34,19 +43,24 @@ void itsol_zrmC(int m, int n, ITS_BData data);
 void itsol_copyBData(int m, int n, ITS_BData dst, ITS_BData src, int isig); 
 int itsol_CSRcs(int n, double *a, int *ja, int *ia, ITS_SparMat *mat, int rsa); 
 int itsol_csrvbsrC(int job, int nBlk, int *nB, ITS_SparMat *csmat, ITS_VBSparMat *vbmat);  
+int itsol_csrsellC(ITS_SparMat *csmat, int sigma, ITS_SellMat *sell);
+int itsol_sellvals(ITS_SparMat *csmat, ITS_SellMat *sell);
+int itsol_cleanSELL(ITS_SellMat *sell);
 int itsol_col2vbcol(int col, ITS_VBSparMat *vbmat);
-int itsol_nnz_vbilu(ITS_VBILUSpar *lu); 
-int itsol_nnz_lev4(ITS_Per4Mat *levmat, int *lev, FILE *ft);
+ITS_INT itsol_nnz_vbilu(ITS_VBILUSpar *lu); 
+ITS_INT itsol_nnz_lev4(ITS_Per4Mat *levmat, int *lev, FILE *ft);
 int itsol_setupILU(ITS_ILUSpar *lu, int n);
+int itsol_setupILUdom(ITS_ILUSpar *lu, int ndom, int *dom);
 int itsol_CS2lum(int n, ITS_SparMat *Amat, ITS_ILUSpar *mat, int typ);
-int itsol_COOcs(int n, int nnz,  double *a, int *ja, int *ia, ITS_SparMat *bmat);
+int itsol_COOcs(int n, ITS_INT nnz,  double *a, int *ja, int *ia, ITS_SparMat *bmat);
+int itsol_COOcsflat(int n, ITS_INT nnz,  double *a, int *ja, int *ia, ITS_SparMat *bmat);
 void itsol_coocsr_(int*, int*, double*, int*, int*, double*, int*, int*);
 
 int itsol_csSplit4(ITS_SparMat *amat, int bsize, int csize, ITS_SparMat *B, ITS_SparMat *F, ITS_SparMat *E, ITS_SparMat *C);
 void itsol_setup_arms (ITS_ARMSpar *Levmat);
 int itsol_cleanARMS(ITS_ARMSpar *ArmsPre);
 void itsol_coocsc(int n, int nnz, double *val, int *col, int *row, double **a, int **ja, int **ia, int job);
-int itsol_nnz_ilu(ITS_ILUSpar *lu);
+ITS_INT itsol_nnz_ilu(ITS_ILUSpar *lu);
 int itsol_CSClum(int n, double *a, int *ja, int *ia, ITS_ILUSpar *mat, int rsa);
 int itsol_CSClumC(ITS_SparMat *amat, ITS_ILUSpar *mat, int rsa);
 
@@ -0,0 +1,855 @@
+
+#include "bin-io.h"
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+typedef struct bin_head_
+{
+    char magic[8];
+    int32_t version;
+    int32_t endian;
+    int32_t kind;
+    int32_t isize;
+    int64_t n;
+    int64_t nnz;
+    int64_t off_ma;
+    int64_t off_ia;
+    int64_t off_ja;
+} bin_head_;
+
+static const char magic_[8] = {'I', 'T', 'S', 'O', 'L', 'M', 'A', 'T'};
+
+static int64_t align_(int64_t off)
+{
+    return (off + ITS_BIN_ALIGN - 1) / ITS_BIN_ALIGN * ITS_BIN_ALIGN;
+}
+
+/* header of a COO matrix of size n with nnz entries */
+static void layout_(bin_head_ *h, int n, ITS_INT nnz)
+{
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, magic_, sizeof(magic_));
+
+    h->version = ITS_BIN_VERSION;
+    h->endian = 0x01020304;
+    h->kind = ITS_BIN_COO;
+    h->isize = sizeof(int);
+    h->n = n;
+    h->nnz = nnz;
+
+    h->off_ma = align_(sizeof(*h));
+    h->off_ia = align_(h->off_ma + (int64_t)nnz * sizeof(double));
+    h->off_ja = align_(h->off_ia + (int64_t)nnz * sizeof(int));
+}
+
+/* 0: header usable with a file of size bytes (size < 0: unknown),
+   2: not a matrix file this build can read, 3: file too short,
+   4: n too large for int or nnz for ITS_INT */
+static int check_(bin_head_ *h, int64_t size)
+{
+    if (memcmp(h->magic, magic_, sizeof(magic_)) != 0 || h->version != ITS_BIN_VERSION
+            || h->endian != 0x01020304 || h->kind != ITS_BIN_COO || h->isize != (int32_t)sizeof(int))
+        return 2;
+
+    if (h->n < 0 || h->nnz < 0 || h->off_ma % sizeof(double) != 0
+            || h->off_ia % sizeof(int) != 0 || h->off_ja % sizeof(int) != 0)
+        return 2;
+
+    if (h->n > INT_MAX || h->nnz > ITS_INT_MAX) return 4;
+
+    if (size >= 0 && (h->off_ma + h->nnz * (int64_t)sizeof(double) > size
+                || h->off_ia + h->nnz * (int64_t)sizeof(int) > size
+                || h->off_ja + h->nnz * (int64_t)sizeof(int) > size))
+        return 3;
+
+    return 0;
+}
+
+/* zeros up to byte offset off, then count items of buf */
+static int put_(FILE *fp, int64_t *pos, int64_t off, void *buf, size_t size, size_t count)
+{
+    static const char zero[ITS_BIN_ALIGN] = {0};
+    size_t len = off - *pos;
+
+    if (len > 0 && fwrite(zero, 1, len, fp) != len) return 1;
+    if (fwrite(buf, size, count, fp) != count) return 1;
+
+    *pos = off + (int64_t)(size * count);
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+  | write a COO matrix in the binary format of bin-io.h
+  |----------------------------------------------------------------------
+  | return 0 on success, 1 if the file cannot be opened, 3 on a write
+  | error.
+  |--------------------------------------------------------------------*/
+int itsol_write_bin(char *fname, ITS_CooMat *A)
+{
+    FILE *fp;
+    bin_head_ h;
+    int64_t pos;
+    size_t nnz = A->nnz;
+    int ierr = 0;
+
+    if ((fp = fopen(fname, "wb")) == NULL) return 1;
+
+    layout_(&h, A->n, A->nnz);
+
+    pos = 0;
+    if (put_(fp, &pos, 0, &h, sizeof(h), 1) || put_(fp, &pos, h.off_ma, A->ma, sizeof(double), nnz)
+            || put_(fp, &pos, h.off_ia, A->ia, sizeof(int), nnz)
+            || put_(fp, &pos, h.off_ja, A->ja, sizeof(int), nnz))
+        ierr = 3;
+
+    if (fclose(fp) != 0) ierr = 3;
+
+    return ierr;
+}
+
+/* read the arrays into memory owned by A */
+static int read_copy_(char *fname, ITS_CooMat *A)
+{
+    FILE *fp;
+    bin_head_ h;
+    size_t nnz;
+    int ierr;
+
+    if ((fp = fopen(fname, "rb")) == NULL) return 1;
+
+    if (fread(&h, sizeof(h), 1, fp) != 1) {
+        fclose(fp);
+        return 3;
+    }
+
+    if ((ierr = check_(&h, -1)) != 0) {
+        fclose(fp);
+        return ierr;
+    }
+
+    nnz = h.nnz;
+    A->n = h.n;
+    A->nnz = h.nnz;
+    A->ma = (double *)itsol_malloc(its_max(nnz, 1) * sizeof(double), "read_bin:1");
+    A->ia = (int *)itsol_malloc(its_max(nnz, 1) * sizeof(int), "read_bin:2");
+    A->ja = (int *)itsol_malloc(its_max(nnz, 1) * sizeof(int), "read_bin:3");
+
+    ierr = 0;
+    if (fseek(fp, h.off_ma, SEEK_SET) != 0 || fread(A->ma, sizeof(double), nnz, fp) != nnz
+            || fseek(fp, h.off_ia, SEEK_SET) != 0 || fread(A->ia, sizeof(int), nnz, fp) != nnz
+            || fseek(fp, h.off_ja, SEEK_SET) != 0 || fread(A->ja, sizeof(int), nnz, fp) != nnz)
+        ierr = 3;
+
+    fclose(fp);
+
+    if (ierr != 0) {
+        free(A->ma);
+        free(A->ia);
+        free(A->ja);
+        memset(A, 0, sizeof(*A));
+    }
+
+    return ierr;
+}
+
+/*----------------------------------------------------------------------
+  | read a COO matrix written by itsol_write_bin
+  |----------------------------------------------------------------------
+  | The file is mapped copy-on-write and A->ia, A->ja, A->ma point into
+  | the mapping: nothing is parsed or copied, pages are read in as the
+  | arrays are used, and writes into A (itsol_solver_update_values) stay
+  | private to the process. Where the file cannot be mapped (_WIN32) the
+  | arrays are read into allocated memory instead. Either way
+  | itsol_cleanCOO releases A.
+  |
+  | return 0 on success, 1 if the file cannot be opened, 2 if it is not
+  | a matrix file of this version / byte order / int size, 3 if it is
+  | truncated, 4 if the matrix is too large for the index types.
+  |--------------------------------------------------------------------*/
+int itsol_read_bin(char *fname, ITS_CooMat *A)
+{
+    memset(A, 0, sizeof(*A));
+
+#ifndef _WIN32
+    {
+        struct stat st;
+        bin_head_ *h;
+        char *map;
+        int fd, ierr;
+
+        if ((fd = open(fname, O_RDONLY)) < 0) return 1;
+
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return 1;
+        }
+
+        if (st.st_size < (off_t)sizeof(*h)) {
+            close(fd);
+            return 3;
+        }
+
+        map = (char *)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (map == MAP_FAILED) return read_copy_(fname, A);
+
+        h = (bin_head_ *)map;
+        if ((ierr = check_(h, st.st_size)) != 0) {
+            munmap(map, st.st_size);
+            return ierr;
+        }
+
+#ifdef MADV_WILLNEED
+        madvise(map, st.st_size, MADV_WILLNEED);
+#endif
+
+        A->n = h->n;
+        A->nnz = h->nnz;
+        A->ma = (double *)(map + h->off_ma);
+        A->ia = (int *)(map + h->off_ia);
+        A->ja = (int *)(map + h->off_ja);
+        A->map = map;
+        A->maplen = st.st_size;
+
+        return 0;
+    }
+#else
+    return read_copy_(fname, A);
+#endif
+}
+
+/*----------------------------------------------------------------------
+  | release the file mapping of a matrix read by itsol_read_bin
+  |--------------------------------------------------------------------*/
+int itsol_unmap_bin(ITS_CooMat *A)
+{
+    if (A->map == NULL) return 0;
+
+#ifndef _WIN32
+    munmap(A->map, A->maplen);
+#endif
+
+    A->map = NULL;
+    A->maplen = 0;
+    A->ia = A->ja = NULL;
+    A->ma = NULL;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+  | preconditioner files
+  |--------------------------------------------------------------------*/
+typedef struct pc_head_
+{
+    char magic[8];
+    int32_t version;
+    int32_t endian;
+    int32_t isize;
+    int32_t pc_type;
+    int64_t n;
+} pc_head_;
+
+static const char pcmagic_[8] = {'I', 'T', 'S', 'O', 'L', 'P', 'C', '\0'};
+
+/* stream of a pc file; err: 0, 2 bad contents, 3 read / write error.
+   After an error nothing more is written and reads return zeros, so
+   that what was built so far stays consistent and can be cleaned. */
+typedef struct pc_file_
+{
+    FILE *fp;
+    int err;
+} pc_file_;
+
+static void wr_(pc_file_ *f, void *buf, size_t size, size_t count)
+{
+    if (f->err == 0 && count > 0 && fwrite(buf, size, count, f->fp) != count)
+        f->err = 3;
+}
+
+static void rd_(pc_file_ *f, void *buf, size_t size, size_t count)
+{
+    if (count == 0) return;
+    if (f->err == 0 && fread(buf, size, count, f->fp) == count) return;
+
+    if (f->err == 0) f->err = 3;
+    memset(buf, 0, size * count);
+}
+
+/* single precision values (itsol_csfloat, itsol_vbfloat), written as
+   doubles: the file does not depend on ITS_PARS.pc_float */
+static void wr_fvals_(pc_file_ *f, float *v, int count)
+{
+    double buf[256];
+    int i, k, len;
+
+    for (k = 0; k < count; k += len) {
+        len = its_min(count - k, 256);
+        for (i = 0; i < len; i++)
+            buf[i] = v[k + i];
+        wr_(f, buf, sizeof(double), len);
+    }
+}
+
+static void bad_(pc_file_ *f)
+{
+    if (f->err == 0) f->err = 2;
+}
+
+static int rd_int_(pc_file_ *f)
+{
+    int v;
+
+    rd_(f, &v, sizeof(int), 1);
+    return v;
+}
+
+/* int vector of length n, or NULL: flag then entries */
+static void wr_ivec_(pc_file_ *f, int *v, int n)
+{
+    int has = v != NULL;
+
+    wr_(f, &has, sizeof(int), 1);
+    if (has) wr_(f, v, sizeof(int), n);
+}
+
+/* entries are permutations, checked to lie in [0, n) */
+static int *rd_ivec_(pc_file_ *f, int n)
+{
+    int i, *v;
+
+    if (rd_int_(f) == 0) return NULL;
+
+    v = (int *)itsol_malloc(n * sizeof(int), "pc_load:ivec");
+    rd_(f, v, sizeof(int), n);
+
+    for (i = 0; i < n; i++) {
+        if (v[i] < 0 || v[i] >= n) {
+            bad_(f);
+            v[i] = 0;
+        }
+    }
+
+    return v;
+}
+
+static void wr_dvec_(pc_file_ *f, double *v, int n)
+{
+    int has = v != NULL;
+
+    wr_(f, &has, sizeof(int), 1);
+    if (has) wr_(f, v, sizeof(double), n);
+}
+
+static double *rd_dvec_(pc_file_ *f, int n)
+{
+    double *v;
+
+    if (rd_int_(f) == 0) return NULL;
+
+    v = (double *)itsol_malloc(n * sizeof(double), "pc_load:dvec");
+    rd_(f, v, sizeof(double), n);
+
+    return v;
+}
+
+/* CSR matrix: n, row lengths, column indices of all rows, then values */
+static void wr_cs_(pc_file_ *f, ITS_SparMat *A)
+{
+    int i, n = A->n;
+
+    wr_(f, &n, sizeof(int), 1);
+    wr_(f, A->nzcount, sizeof(int), n);
+
+    for (i = 0; i < n; i++)
+        wr_(f, A->ja[i], sizeof(int), A->nzcount[i]);
+
+    for (i = 0; i < n; i++) {
+        if (A->fa)
+            wr_fvals_(f, A->fa[i], A->nzcount[i]);
+        else
+            wr_(f, A->ma[i], sizeof(double), A->nzcount[i]);
+    }
+}
+
+/* n x m matrix, read into flat storage */
+static ITS_SparMat *rd_cs_(pc_file_ *f, int n, int m)
+{
+    ITS_SparMat *A;
+    ITS_INT nnz = 0, k;
+    int i;
+
+    A = (ITS_SparMat *)itsol_malloc(sizeof(ITS_SparMat), "pc_load:cs");
+    itsol_setupCS(A, n, 1);
+
+    if (rd_int_(f) != n) bad_(f);
+    rd_(f, A->nzcount, sizeof(int), n);
+
+    for (i = 0; i < n; i++) {
+        if (A->nzcount[i] < 0 || A->nzcount[i] > m || nnz + A->nzcount[i] > ITS_INT_MAX) {
+            bad_(f);
+            A->nzcount[i] = 0;
+        }
+        nnz += A->nzcount[i];
+    }
+
+    itsol_csflat(A, 0);
+    rd_(f, A->jflat, sizeof(int), nnz);
+    rd_(f, A->mflat, sizeof(double), nnz);
+
+    for (k = 0; k < nnz; k++) {
+        if (A->jflat[k] < 0 || A->jflat[k] >= m) {
+            bad_(f);
+            A->jflat[k] = 0;
+        }
+    }
+
+    return A;
+}
+
+static void wr_ilu_(pc_file_ *f, ITS_ILUSpar *lu, int *perm)
+{
+    wr_(f, lu->D, sizeof(double), lu->n);
+    wr_cs_(f, lu->L);
+    wr_cs_(f, lu->U);
+    wr_ivec_(f, perm, lu->n);
+}
+
+/* the ordering of the factored matrix (perm_type), if any, goes to *perm */
+static ITS_ILUSpar *rd_ilu_(pc_file_ *f, int n, int **perm)
+{
+    ITS_ILUSpar *lu;
+
+    lu = (ITS_ILUSpar *)itsol_malloc(sizeof(ITS_ILUSpar), "pc_load:ilu");
+    lu->n = n;
+    lu->D = (double *)itsol_malloc(n * sizeof(double), "pc_load:ilu");
+    rd_(f, lu->D, sizeof(double), n);
+
+    lu->L = rd_cs_(f, n, n);
+    lu->U = rd_cs_(f, n, n);
+    lu->work = (int *)itsol_malloc(n * sizeof(int), "pc_load:ilu");
+    lu->nsweep = 0;
+    lu->swk = NULL;
+    lu->ndom = 0;
+    lu->dom = NULL;
+    *perm = rd_ivec_(f, n);
+
+#ifdef ITSOL_USE_OPENMP
+    itsol_levsched(lu->L, 0);
+    itsol_levsched(lu->U, 1);
+#endif
+
+    return lu;
+}
+
+/* block matrix: row lengths, block columns of all rows, then the
+   blocks row by row, ITS_B_DIM(bsz, i) x ITS_B_DIM(bsz, col) each */
+static void wr_vbm_(pc_file_ *f, ITS_VBSparMat *A, int *bsz)
+{
+    int i, j, n = A->n, dim, sz, len;
+
+    wr_(f, A->nzcount, sizeof(int), n);
+
+    for (i = 0; i < n; i++)
+        wr_(f, A->ja[i], sizeof(int), A->nzcount[i]);
+
+    for (i = 0; i < n; i++) {
+        dim = ITS_B_DIM(bsz, i);
+        len = 0;
+        for (j = 0; j < A->nzcount[i]; j++) {
+            sz = dim * ITS_B_DIM(bsz, A->ja[i][j]);
+            if (A->fa)
+                wr_fvals_(f, A->fa[i] + len, sz);
+            else
+                wr_(f, A->ba[i][j], sizeof(double), sz);
+            len += sz;
+        }
+    }
+}
+
+static ITS_VBSparMat *rd_vbm_(pc_file_ *f, int n, int *bsz)
+{
+    ITS_VBSparMat *A;
+    int i, j, nz, dim, len;
+
+    A = (ITS_VBSparMat *)itsol_malloc(sizeof(ITS_VBSparMat), "pc_load:vbm");
+    itsol_setupVBMat(A, n, NULL);
+
+    rd_(f, A->nzcount, sizeof(int), n);
+
+    for (i = 0; i < n; i++) {
+        if (A->nzcount[i] < 0 || A->nzcount[i] > n) {
+            bad_(f);
+            A->nzcount[i] = 0;
+        }
+
+        nz = A->nzcount[i];
+        A->ja[i] = (int *)itsol_malloc(nz * sizeof(int), "pc_load:vbm");
+        A->ba[i] = (ITS_BData *)itsol_malloc(nz * sizeof(ITS_BData), "pc_load:vbm");
+        rd_(f, A->ja[i], sizeof(int), nz);
+
+        for (j = 0; j < nz; j++) {
+            if (A->ja[i][j] < 0 || A->ja[i][j] >= n) {
+                bad_(f);
+                A->ja[i][j] = 0;
+            }
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        dim = ITS_B_DIM(bsz, i);
+        for (j = 0; j < A->nzcount[i]; j++) {
+            len = dim * ITS_B_DIM(bsz, A->ja[i][j]);
+            A->ba[i][j] = (ITS_BData)itsol_malloc(len * sizeof(double), "pc_load:vbm");
+            rd_(f, A->ba[i][j], sizeof(double), len);
+        }
+    }
+
+    return A;
+}
+
+static void wr_vbilu_(pc_file_ *f, ITS_VBILUSpar *lu, int *perm)
+{
+    int i, n = lu->n, dim;
+
+    wr_(f, lu->bsz, sizeof(int), n + 1);
+    wr_(f, &lu->DiagOpt, sizeof(int), 1);
+
+    for (i = 0; i < n; i++) {
+        dim = ITS_B_DIM(lu->bsz, i);
+        wr_(f, lu->D[i], sizeof(double), dim * dim);
+    }
+
+    wr_vbm_(f, lu->L, lu->bsz);
+    wr_vbm_(f, lu->U, lu->bsz);
+    wr_ivec_(f, perm, lu->bsz[n]);
+}
+
+/* n block rows; the permutation of the rows goes to *perm */
+static ITS_VBILUSpar *rd_vbilu_(pc_file_ *f, int n, int **perm)
+{
+    ITS_VBILUSpar *lu;
+    int i, dim, *bsz;
+
+    bsz = (int *)itsol_malloc((n + 1) * sizeof(int), "pc_load:vbilu");
+    rd_(f, bsz, sizeof(int), n + 1);
+
+    /* the block sizes are needed to size everything else */
+    for (i = 0; i < n; i++) {
+        dim = bsz[i + 1] - bsz[i];
+        if (bsz[0] != 0 || dim < 1 || dim > ITS_MAX_BLOCK_SIZE) {
+            bad_(f);
+            free(bsz);
+            return NULL;
+        }
+    }
+
+    lu = (ITS_VBILUSpar *)itsol_malloc(sizeof(ITS_VBILUSpar), "pc_load:vbilu");
+    lu->n = n;
+    lu->bsz = bsz;
+    lu->DiagOpt = rd_int_(f);
+
+    lu->D = (ITS_BData *)itsol_malloc(n * sizeof(ITS_BData), "pc_load:vbilu");
+    for (i = 0; i < n; i++) {
+        dim = ITS_B_DIM(bsz, i);
+        lu->D[i] = (ITS_BData)itsol_malloc(dim * dim * sizeof(double), "pc_load:vbilu");
+        rd_(f, lu->D[i], sizeof(double), dim * dim);
+    }
+
+    lu->L = rd_vbm_(f, n, bsz);
+    lu->U = rd_vbm_(f, n, bsz);
+    lu->work = (int *)itsol_malloc(n * sizeof(int), "pc_load:vbilu");
+    lu->bf = (ITS_BData)itsol_malloc(ITS_MAX_BLOCK_SIZE * ITS_MAX_BLOCK_SIZE * sizeof(double),
+            "pc_load:vbilu");
+
+    *perm = rd_ivec_(f, bsz[n]);
+    if (*perm == NULL) bad_(f);
+
+    return lu;
+}
+
+/* levels of the ARMS chain, then the factors of the last Schur
+   complement */
+static void wr_arms_(pc_file_ *f, ITS_ARMSpar *arms)
+{
+    ITS_Per4Mat *lev = arms->levmat;
+    ITS_ILUTSpar *ilus = arms->ilus;
+    int k;
+
+    wr_(f, &arms->nlev, sizeof(int), 1);
+
+    for (k = 0; k < arms->nlev; k++, lev = lev->next) {
+        wr_(f, &lev->n, sizeof(int), 1);
+        wr_(f, &lev->nB, sizeof(int), 1);
+        wr_(f, &lev->symperm, sizeof(int), 1);
+
+        wr_cs_(f, lev->L);
+        wr_cs_(f, lev->U);
+        wr_cs_(f, lev->E);
+        wr_cs_(f, lev->F);
+
+        wr_ivec_(f, lev->perm, lev->n);
+        if (!lev->symperm) wr_ivec_(f, lev->rperm, lev->n);
+        wr_dvec_(f, lev->D1, lev->n);
+        wr_dvec_(f, lev->D2, lev->n);
+    }
+
+    wr_(f, &ilus->n, sizeof(int), 1);
+    if (arms->nlev > 0) wr_cs_(f, ilus->C);
+    wr_cs_(f, ilus->L);
+    wr_cs_(f, ilus->U);
+
+    wr_ivec_(f, ilus->rperm, ilus->n);
+    wr_ivec_(f, ilus->perm, ilus->n);
+    wr_ivec_(f, ilus->perm2, ilus->n);
+    wr_dvec_(f, ilus->D1, ilus->n);
+    wr_dvec_(f, ilus->D2, ilus->n);
+}
+
+/* the chain is built level by level as in itsol_pc_arms2, so that
+   itsol_cleanARMS can release it after an error at any point */
+static ITS_ARMSpar *rd_arms_(pc_file_ *f, int n)
+{
+    ITS_ARMSpar *arms;
+    ITS_Per4Mat *lev, *prev = NULL;
+    ITS_ILUTSpar *ilus;
+    ITS_SparMat *E, *F;
+    int k, nA = n, nB, nC;
+
+    arms = (ITS_ARMSpar *)itsol_malloc(sizeof(ITS_ARMSpar), "pc_load:arms");
+    itsol_setup_arms(arms);
+    memset(arms->levmat, 0, sizeof(ITS_Per4Mat));
+    memset(arms->ilus, 0, sizeof(ITS_ILUTSpar));
+
+    arms->n = n;
+    arms->nlev = rd_int_(f);
+    if (arms->nlev < 0 || arms->nlev > n) {
+        bad_(f);
+        arms->nlev = 0;
+    }
+
+    lev = arms->levmat;
+    for (k = 0; k < arms->nlev; k++) {
+        if (k > 0) {
+            lev = (ITS_Per4Mat *)itsol_malloc(sizeof(ITS_Per4Mat), "pc_load:arms");
+            memset(lev, 0, sizeof(ITS_Per4Mat));
+            prev->next = lev;
+            lev->prev = prev;
+        }
+
+        /* level sizes: nA = nB + nC, nA the nC of the previous level */
+        if (rd_int_(f) != nA) bad_(f);
+        nB = rd_int_(f);
+        if (f->err != 0 || nB < 1 || nB >= nA) {
+            bad_(f);
+            arms->nlev = k;
+            if (prev) prev->next = NULL;
+            if (k > 0) free(lev);
+            lev = prev;
+            break;
+        }
+        nC = nA - nB;
+        lev->symperm = rd_int_(f);
+
+        /* L, U, wk as itsol_setupP4 does, with matrices read from f */
+        lev->n = nA;
+        lev->nB = nB;
+        lev->wk = prev ? prev->wk : (double *)itsol_malloc(2 * nA * sizeof(double), "pc_load:arms");
+        lev->L = rd_cs_(f, nB, nB);
+        lev->U = rd_cs_(f, nB, nB);
+        E = rd_cs_(f, nC, nB);
+        F = rd_cs_(f, nB, nC);
+        lev->E = E;
+        lev->F = F;
+
+        lev->perm = rd_ivec_(f, nA);
+        lev->rperm = lev->symperm ? lev->perm : rd_ivec_(f, nA);
+        if (lev->perm == NULL || lev->rperm == NULL) bad_(f);
+        lev->D1 = rd_dvec_(f, nA);
+        lev->D2 = rd_dvec_(f, nA);
+
+        lev->blk = (int *)itsol_malloc((nB + 1) * sizeof(int), "pc_load:arms");
+        lev->nblk = itsol_diagblocks(lev->L, lev->U, nB, lev->blk);
+#ifdef ITSOL_USE_OPENMP
+        itsol_levsched(lev->L, 0);
+        itsol_levsched(lev->U, 1);
+#endif
+
+        prev = lev;
+        nA = nC;
+    }
+
+    /* last Schur complement, ILUT factors and work as itsol_setupILUT */
+    ilus = arms->ilus;
+    if (rd_int_(f) != nA) bad_(f);
+    ilus->n = nA;
+    ilus->wk = (double *)itsol_malloc(2 * nA * sizeof(double), "pc_load:arms");
+    if (arms->nlev > 0) ilus->C = rd_cs_(f, nA, nA);
+    ilus->L = rd_cs_(f, nA, nA);
+    ilus->U = rd_cs_(f, nA, nA);
+
+    ilus->rperm = rd_ivec_(f, nA);
+    ilus->perm = rd_ivec_(f, nA);
+    ilus->perm2 = rd_ivec_(f, nA);
+    ilus->D1 = rd_dvec_(f, nA);
+    ilus->D2 = rd_dvec_(f, nA);
+
+#ifdef ITSOL_USE_OPENMP
+    itsol_levsched(ilus->L, 0);
+    itsol_levsched(ilus->U, 1);
+#endif
+
+    return arms;
+}
+
+/*----------------------------------------------------------------------
+  | write an assembled preconditioner to a binary file
+  |----------------------------------------------------------------------
+  | pc  = ILUK, ILUT, PARILU, VBILUK, VBILUT or ARMS preconditioner,
+  |       assembled.
+  |
+  | The file holds a header (magic "ITSOLPC", ITS_BIN_VERSION, byte
+  | order, int size, pc type, dimension) and the factors as stored in
+  | memory: ILU factors with the ordering of perm_type if any, block ILU
+  | factors with the block sizes and the permutation, or the whole ARMS
+  | chain (per level L, U, E, F, permutations and scalings, then the
+  | factors of the last Schur complement). It is read back by
+  | itsol_pc_load.
+  |
+  | return 0 on success, 1 if the file cannot be opened, 2 if pc is of
+  | a type that cannot be saved (ILUC), 3 on a write error.
+  |--------------------------------------------------------------------*/
+int itsol_pc_save(ITS_PC *pc, char *fname)
+{
+    pc_head_ h;
+    pc_file_ f;
+    ITS_PC_TYPE pctype = pc->pc_type;
+
+    if (pctype != ITS_PC_ILUK && pctype != ITS_PC_ILUT && pctype != ITS_PC_VBILUK
+            && pctype != ITS_PC_VBILUT && pctype != ITS_PC_ARMS && pctype != ITS_PC_PARILU)
+        return 2;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, pcmagic_, sizeof(pcmagic_));
+    h.version = ITS_BIN_VERSION;
+    h.endian = 0x01020304;
+    h.isize = sizeof(int);
+    h.pc_type = pctype;
+
+    if (pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT
+            || pctype == ITS_PC_PARILU)
+        h.n = pc->ILU->n;
+    else if (pctype == ITS_PC_ARMS)
+        h.n = pc->ARMS->n;
+    else
+        h.n = pc->VBILU->n;
+
+    if ((f.fp = fopen(fname, "wb")) == NULL) return 1;
+    f.err = 0;
+
+    wr_(&f, &h, sizeof(h), 1);
+
+    if (pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT
+            || pctype == ITS_PC_PARILU)
+        wr_ilu_(&f, pc->ILU, pc->perm);
+    else if (pctype == ITS_PC_ARMS)
+        wr_arms_(&f, pc->ARMS);
+    else
+        wr_vbilu_(&f, pc->VBILU, pc->perm);
+
+    if (fclose(f.fp) != 0) f.err = 3;
+
+    return f.err;
+}
+
+/*----------------------------------------------------------------------
+  | read a preconditioner written by itsol_pc_save
+  |----------------------------------------------------------------------
+  | pc  = initialized by itsol_pc_initialize with the type of the saved
+  |       preconditioner, not assembled.
+  |
+  | On return pc holds the factors and can be applied as after
+  | itsol_pc_assemble: ILU and ARMS factors are in flat storage, level
+  | schedules are rebuilt in threaded builds. Nothing is factored.
+  | pc->precon is not set, nor is the matrix permuted by pc->perm (block
+  | preconditioners, orderings of the ILU ones); itsol_solver_load_pc
+  | does both.
+  |
+  | return 0 on success, 1 if the file cannot be opened, 2 if it is not
+  | a preconditioner of the type of pc from a machine of the same byte
+  | order and int size, or its contents are inconsistent, 3 if it is
+  | truncated. pc is left as it was on error.
+  |--------------------------------------------------------------------*/
+int itsol_pc_load(ITS_PC *pc, char *fname)
+{
+    pc_head_ h;
+    pc_file_ f;
+    ITS_PC_TYPE pctype = pc->pc_type;
+    ITS_ILUSpar *ilu = NULL;
+    ITS_VBILUSpar *vbilu = NULL;
+    ITS_ARMSpar *arms = NULL;
+    int *perm = NULL, n;
+
+    if ((f.fp = fopen(fname, "rb")) == NULL) return 1;
+    f.err = 0;
+
+    rd_(&f, &h, sizeof(h), 1);
+    if (f.err == 0 && (memcmp(h.magic, pcmagic_, sizeof(pcmagic_)) != 0
+                || h.version != ITS_BIN_VERSION || h.endian != 0x01020304
+                || h.isize != (int32_t)sizeof(int) || h.pc_type != (int32_t)pctype
+                || h.n < 1 || h.n > INT_MAX))
+        f.err = 2;
+
+    if (f.err != 0) {
+        fclose(f.fp);
+        return f.err;
+    }
+
+    n = h.n;
+    if (pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT
+            || pctype == ITS_PC_PARILU)
+        ilu = rd_ilu_(&f, n, &perm);
+    else if (pctype == ITS_PC_ARMS)
+        arms = rd_arms_(&f, n);
+    else if (pctype == ITS_PC_VBILUK || pctype == ITS_PC_VBILUT)
+        vbilu = rd_vbilu_(&f, n, &perm);
+    else
+        f.err = 2;
+
+    fclose(f.fp);
+
+    if (f.err != 0) {
+        if (ilu) itsol_cleanILU(ilu);
+        if (arms) itsol_cleanARMS(arms);
+        if (vbilu) itsol_cleanVBILU(vbilu);
+        if (perm) free(perm);
+
+        return f.err;
+    }
+
+    /* replace the empty structs of itsol_pc_initialize */
+    if (ilu) {
+        free(pc->ILU);
+        pc->ILU = ilu;
+        pc->perm = perm;
+    }
+    else if (arms) {
+        free(pc->ARMS);
+        pc->ARMS = arms;
+    }
+    else {
+        free(pc->VBILU);
+        pc->VBILU = vbilu;
+        pc->perm = perm;
+    }
+
+    return 0;
+}
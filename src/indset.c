@@ -1,8 +1,16 @@
 
 #include "indset.h"
 
+#ifdef ITSOL_USE_OPENMP
+#include <omp.h>
+#endif
+
 #define  ALPHA  0.00001
 
+/* itsol_indsetC_par falls back to itsol_indsetC when more than
+   n / INDSET_MAXITF nodes are on the slab boundaries */
+#define  INDSET_MAXITF  20
+
 /*----------------------------------------------------------------------
   |   adds element nod to independent set
   |---------------------------------------------------------------------*/
@@ -32,6 +40,12 @@ int itsol_weightsC(ITS_SparMat *mat, double *w)
 {
     int irow, k, n = mat->n, *kj, kz;
     double tdia, wmax = 0.0, tnorm, *kr;
+
+#ifdef ITSOL_USE_OPENMP
+    int par = omp_get_max_threads() > 1 && !omp_in_parallel() && n >= ITS_OMP_MIN_ROWS;
+#pragma omp parallel for private(k, kj, kz, kr, tnorm, tdia) reduction(max:wmax) \
+        schedule(dynamic, ITS_OMP_ROW_CHUNK) if (par)
+#endif
     for (irow = 0; irow < n; irow++) {
         kz = mat->nzcount[irow];
         kr = mat->ma[irow];
@@ -49,6 +63,9 @@ int itsol_weightsC(ITS_SparMat *mat, double *w)
         if (tnorm > wmax)
             wmax = tnorm;
     }
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for if (par)
+#endif
     for (irow = 0; irow < n; irow++)
         w[irow] = w[irow] / wmax;
     return 0;
@@ -324,6 +341,253 @@ label50:
     return 0;
 }
 
+/* breadth first search from root over the nodes marked from, which
+   are marked to and listed in q in the order reached. returns how
+   many. */
+static int indset_bfs_(ITS_SparMat *mat, ITS_SparMat *matT, int root, int from, int to,
+        int *mark, int *q)
+{
+    int head, tail, j, k, jcol;
+    ITS_SparMat *gmat;
+
+    q[0] = root;
+    mark[root] = to;
+    for (head = 0, tail = 1; head < tail; head++) {
+        gmat = mat;
+        for (k = 0; k < 2; k++) {
+            for (j = 0; j < gmat->nzcount[q[head]]; j++) {
+                jcol = gmat->ja[q[head]][j];
+                if (mark[jcol] == from) {
+                    mark[jcol] = to;
+                    q[tail++] = jcol;
+                }
+            }
+            gmat = matT;
+        }
+    }
+
+    return tail;
+}
+
+/* greedy blocks of itsol_indsetC on the undecided nodes of the list
+   nod[0 .. nn-1], none of them coupled to an undecided node outside
+   the list. st: 0 undecided, 1 independent set, 2 complement. The
+   independent set nodes are listed in lst, block by block, returns
+   how many. */
+static int indset_blocks_(ITS_SparMat *mat, ITS_SparMat *matT, int bsize, int *nod, int nn,
+        int *st, int *lst)
+{
+    int l, begin, begin0, last, last0, lastlev, jcount, jcount0, prog, inod, jnod,
+        j, k, jcol, mid, *rowj;
+    ITS_SparMat *gmat;
+
+    last = -1;
+    for (l = 0; l < nn; l++) {
+        if (st[nod[l]] != 0) continue;
+
+        st[nod[l]] = 1;
+        lst[++last] = nod[l];
+        begin = begin0 = lastlev = last;
+        jcount = 1;
+        /*-------------------- nearest neighbors until the block has bsize */
+        prog = 1;
+        while (jcount < bsize && prog) {
+            last0 = last;
+            jcount0 = jcount;
+            for (inod = begin; inod <= last0; inod++) {
+                jnod = lst[inod];
+                gmat = mat;
+                for (k = 0; k < 2; k++) {
+                    rowj = gmat->ja[jnod];
+                    for (j = 0; j < gmat->nzcount[jnod]; j++) {
+                        jcol = rowj[j];
+                        if (st[jcol] == 0) {
+                            st[jcol] = 1;
+                            lst[++last] = jcol;
+                            jcount++;
+                        }
+                    }
+                    gmat = matT;
+                }
+            }
+            prog = jcount > jcount0 ? 1 : 0;
+            lastlev = begin;
+            begin = last0 + 1;
+        }
+        /*-------------------- neighbors of the last level to the complement */
+        gmat = mat;
+        for (k = 0; k < 2; k++) {
+            for (inod = lastlev; inod <= last; inod++) {
+                jnod = lst[inod];
+                rowj = gmat->ja[jnod];
+                for (j = 0; j < gmat->nzcount[jnod]; j++)
+                    if (st[rowj[j]] == 0) st[rowj[j]] = 2;
+            }
+            gmat = matT;
+        }
+        /*-------------------- reverse ordering for this block */
+        mid = (begin0 + last) / 2;
+        for (inod = begin0; inod <= mid; inod++) {
+            j = last - inod + begin0;
+            jnod = lst[inod];
+            lst[inod] = lst[j];
+            lst[j] = jnod;
+        }
+    }
+
+    return last + 1;
+}
+
+/*---------------------------------------------------------------------
+  | parallel variant of itsol_indsetC
+  |----------------------------------------------------------------------
+  | The graph of A + A^T is cut into nchunk slabs of consecutive nodes
+  | of a breadth first order, from a pseudo-peripheral node of each
+  | connected component, so that a slab only touches its neighbor slabs
+  | across a few level sets, whatever the labelling of the rows. A node
+  | coupled to a later slab goes to the complement: then no two slabs
+  | are coupled through undecided nodes, and each slab is blocked by the
+  | greedy algorithm of itsol_indsetC (blocks of up to bsize nodes),
+  | the slabs in parallel. The same diagonal dominance filter (tol,
+  | itsol_weightsC) is applied first.
+  |
+  | When more than n / INDSET_MAXITF nodes sit on the slab boundaries
+  | (small or strongly coupled matrices, as the last levels of ARMS
+  | often are) the set would be much smaller than the one of
+  | itsol_indsetC, which is called instead.
+  |
+  | iord, nnod as for itsol_indsetC: the independent set comes first,
+  | slab by slab, then the complement in natural order. The result
+  | depends on nchunk, not on the number of threads.
+  |---------------------------------------------------------------------*/
+int itsol_indsetC_par(ITS_SparMat *mat, int bsize, int *iord, int *nnod, double tol, int nchunk)
+{
+    int n = mat->n, i, j, k, c, jcol, nok, nitf, nis, *st, *cid, *nod, *lst, *off;
+    double *w;
+    ITS_SparMat *matT, *gmat;
+
+#ifdef ITSOL_USE_OPENMP
+    int par = omp_get_max_threads() > 1 && !omp_in_parallel() && n >= ITS_OMP_MIN_ROWS;
+#endif
+
+    nchunk = its_min(nchunk, n / its_max(bsize, 1));
+    if (nchunk <= 1)
+        return itsol_indsetC(mat, bsize, iord, nnod, tol);
+
+    w = (double *)itsol_malloc(n * sizeof(double), "indsetC_par");
+    st = (int *)itsol_malloc(n * sizeof(int), "indsetC_par");
+    cid = (int *)itsol_malloc(n * sizeof(int), "indsetC_par");
+    nod = (int *)itsol_malloc(n * sizeof(int), "indsetC_par");
+    lst = (int *)itsol_malloc(n * sizeof(int), "indsetC_par");
+    off = (int *)itsol_malloc((nchunk + 1) * sizeof(int), "indsetC_par");
+    matT = (ITS_SparMat *) itsol_malloc(sizeof(ITS_SparMat), "indsetC_par");
+
+    /*-------------------- A^T, and the rows of A sorted as in indsetC */
+    itsol_setupCS(matT, n, 1);
+    itsol_SparTran(mat, matT, 1, 0);
+    itsol_SparTran(matT, mat, 1, 1);
+
+    /*-------------------- breadth first order in lst, component by
+      |                     component: a first sweep from the lowest
+      |                     node finds the root, the last node reached */
+    for (i = 0; i < n; i++)
+        st[i] = 0;
+    for (k = 0, i = 0; i < n; i++) {
+        if (st[i] != 0) continue;
+        j = indset_bfs_(mat, matT, i, 0, 1, st, lst + k);
+        indset_bfs_(mat, matT, lst[k + j - 1], 1, 2, st, lst + k);
+        k += j;
+    }
+
+    /*-------------------- slabs, nodes of each slab in natural order */
+    for (k = 0; k < n; k++)
+        cid[lst[k]] = (int)((long)k * nchunk / n);
+    for (c = 0; c <= nchunk; c++)
+        off[c] = 0;
+    for (i = 0; i < n; i++)
+        off[cid[i] + 1]++;
+    for (c = 0; c < nchunk; c++)
+        off[c + 1] += off[c];
+    for (i = 0; i < n; i++)
+        nod[off[cid[i]]++] = i;
+    for (c = nchunk; c > 0; c--)
+        off[c] = off[c - 1];
+    off[0] = 0;
+
+    /*-------------------- DD filter, then the nodes that pass it and
+      |                     are coupled to one of a later slab that
+      |                     passes it too (st = 3) */
+    itsol_weightsC(mat, w);
+    nok = 0;
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for reduction(+:nok) schedule(static) if (par)
+#endif
+    for (i = 0; i < n; i++) {
+        st[i] = w[i] < tol ? 2 : 0;
+        nok += 1 - st[i] / 2;
+    }
+
+    nitf = 0;
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for private(j, k, jcol, gmat) reduction(+:nitf) \
+        schedule(dynamic, ITS_OMP_ROW_CHUNK) if (par)
+#endif
+    for (i = 0; i < n; i++) {
+        if (st[i] != 0) continue;
+        gmat = mat;
+        for (k = 0; k < 2 && st[i] == 0; k++) {
+            for (j = 0; j < gmat->nzcount[i]; j++) {
+                jcol = gmat->ja[i][j];
+                if (cid[jcol] > cid[i] && st[jcol] != 2) {
+                    st[i] = 3;
+                    nitf++;
+                    break;
+                }
+            }
+            gmat = matT;
+        }
+    }
+
+    if ((long)nitf * INDSET_MAXITF > nok) {
+        itsol_cleanCS(matT);
+        free(w);
+        free(st);
+        free(cid);
+        free(nod);
+        free(lst);
+        free(off);
+        return itsol_indsetC(mat, bsize, iord, nnod, tol);
+    }
+
+    /*-------------------- greedy blocks in each slab; cid holds the
+      |                     set size of the slab from here on */
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1) if (par)
+#endif
+    for (c = 0; c < nchunk; c++)
+        cid[c] = indset_blocks_(mat, matT, bsize, nod + off[c], off[c + 1] - off[c], st,
+                lst + off[c]);
+
+    /*-------------------- iord: the set slab by slab, then the rest */
+    for (nis = 0, c = 0; c < nchunk; c++)
+        for (k = 0; k < cid[c]; k++)
+            iord[lst[off[c] + k]] = nis++;
+    for (k = nis, i = 0; i < n; i++)
+        if (st[i] != 1) iord[i] = k++;
+
+    *nnod = nis;
+
+    itsol_cleanCS(matT);
+    free(w);
+    free(st);
+    free(cid);
+    free(nod);
+    free(lst);
+    free(off);
+
+    return 0;
+}
+
 /*---------------------------------------------------------------------
   | does a preselection of possible diagonal entries. will return a list
   | of "count" bi-indices representing "good" entries to be selected as 
@@ -30,17 +30,137 @@ void itsol_solver_finalize(ITS_SOLVER *s)
     if (s->csmat != NULL) itsol_cleanCS(s->csmat);
     s->csmat = NULL;
 
+    if (s->smat.SELL != NULL) itsol_cleanSELL(s->smat.SELL);
+    s->smat.SELL = NULL;
+
+    if (s->cmap != NULL) free(s->cmap);
+    s->cmap = NULL;
+
+    itsol_cleanWORK(&s->work);
+    itsol_cleanWORK(&s->pwork);
+
     itsol_pc_finalize(&s->pc);
 
     memset(s, 0, sizeof(*s));
 }
 
-int itsol_solver_assemble(ITS_SOLVER *s)
+/* slot of each COO entry inside its CSR row: COOcs stores the entries
+   of a row in the order they come in the COO arrays */
+static int *coo_slots(int n, ITS_INT nnz, int *row)
+{
+    int *len, *map;
+    ITS_INT k;
+
+    len = (int *)itsol_malloc(its_max(n, 1) * sizeof(int), "coo_slots");
+    map = (int *)itsol_malloc(its_max(nnz, 1) * sizeof(int), "coo_slots");
+    memset(len, 0, n * sizeof(int));
+
+    for (k = 0; k < nnz; k++)
+        map[k] = len[row[k]]++;
+
+    free(len);
+    return map;
+}
+
+/* factors of the pc read from pcfile (itsol_solver_load_pc) instead of
+   itsol_pc_assemble, csmat set up as itsol_pc_assemble leaves it */
+static int load_pc_(ITS_SOLVER *s, char *pcfile)
+{
+    ITS_PC *pc = &s->pc;
+    ITS_STATS *st = &s->stats;
+    ITS_PC_TYPE pctype = pc->pc_type;
+    int ierr, n;
+    double t;
+
+    st->t_order = st->t_symb = st->t_num = 0.;
+    st->nnz_pc = 0;
+    t = itsol_get_time();
+
+    if ((ierr = itsol_pc_load(pc, pcfile)) != 0) return ierr;
+
+    if (pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT
+            || pctype == ITS_PC_PARILU)
+        n = pc->ILU->n;
+    else if (pctype == ITS_PC_ARMS)
+        n = pc->ARMS->n;
+    else
+        n = pc->VBILU->bsz[pc->VBILU->n];
+
+    /* saved for another matrix */
+    if (n != s->csmat->n) {
+        itsol_pc_finalize(pc);
+        itsol_pc_initialize(pc, pctype);
+        return 2;
+    }
+
+    if (pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT
+            || pctype == ITS_PC_PARILU) {
+        /* factors of the reordered matrix (perm_type) */
+        if (pc->perm != NULL && itsol_dpermC(s->csmat, pc->perm) != 0) {
+            fprintf(pc->log, "*** dpermC error ***\n");
+            exit(9);
+        }
+        st->nnz_pc = itsol_nnz_ilu(pc->ILU);
+
+        pc->precon = itsol_preconILU;
+        pc->precon_mv = itsol_preconILU_mv;
+    }
+    else if (pctype == ITS_PC_ARMS) {
+        st->nnz_pc = itsol_nnz_arms(pc->ARMS, NULL);
+
+        pc->precon = itsol_preconARMS;
+    }
+    else {
+        /* the block factors are those of the permuted matrix */
+        if (itsol_dpermC(s->csmat, pc->perm) != 0) {
+            fprintf(pc->log, "*** dpermC error ***\n");
+            exit(9);
+        }
+        st->nnz_pc = itsol_nnz_vbilu(pc->VBILU);
+
+        pc->precon = itsol_preconVBR;
+    }
+
+    if (s->pars.pc_float) itsol_pc_float(pc);
+    itsol_pc_sweeps(pc, s->pars.pc_sweeps);
+
+    /* reading the factors stands in for the factorization */
+    st->t_num = itsol_get_time() - t;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+ * undo itsol_solver_assemble: csmat, its SELL copy and the pc are
+ * freed, the pc is initialized again and s is left not assembled, so
+ * that the next assembly starts from the COO matrix.
+ *--------------------------------------------------------------------*/
+static void unassemble_(ITS_SOLVER *s)
+{
+    itsol_cleanCS(s->csmat);
+    s->csmat = NULL;
+
+    if (s->smat.SELL != NULL) itsol_cleanSELL(s->smat.SELL);
+    s->smat.SELL = NULL;
+    s->smat.Mtype = 0;
+
+    if (s->cmap != NULL) free(s->cmap);
+    s->cmap = NULL;
+
+    itsol_pc_finalize(&s->pc);
+    itsol_pc_initialize(&s->pc, s->pc_type);
+
+    s->assembled = 0;
+}
+
+static int assemble_(ITS_SOLVER *s, char *pcfile)
 {
     ITS_PC_TYPE pctype;
     ITS_CooMat A;
     int ierr;
+    int (*coocs)(int, ITS_INT, double *, int *, int *, ITS_SparMat *);
     FILE *log;
+    double t;
 
     assert(s != NULL);
 
@@ -59,9 +179,11 @@ int itsol_solver_assemble(ITS_SOLVER *s)
 
     s->csmat = (ITS_SparMat *) itsol_malloc(sizeof(ITS_SparMat), "solver assemble");
     A = *s->A;
+    coocs = s->pars.csflat ? itsol_COOcsflat : itsol_COOcs;
+    t = itsol_get_time();
 
     if (pctype == ITS_PC_ILUC) {
-        if ((ierr = itsol_COOcs(A.n, A.nnz, A.ma, A.ia, A.ja, s->csmat)) != 0) {
+        if ((ierr = coocs(A.n, A.nnz, A.ma, A.ia, A.ja, s->csmat)) != 0) {
             fprintf(log, "solver assemble, COOcs error\n");
             return ierr;
         }
@@ -72,8 +194,8 @@ int itsol_solver_assemble(ITS_SOLVER *s)
         s->smat.matvec = itsol_matvecCSC;    /* column matvec */
     }
     else if(pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT || pctype == ITS_PC_VBILUK || pctype == ITS_PC_VBILUT
-            || pctype == ITS_PC_ARMS) {
-        if ((ierr = itsol_COOcs(A.n, A.nnz, A.ma, A.ja, A.ia, s->csmat)) != 0) {
+            || pctype == ITS_PC_ARMS || pctype == ITS_PC_PARILU) {
+        if ((ierr = coocs(A.n, A.nnz, A.ma, A.ja, A.ia, s->csmat)) != 0) {
             fprintf(log, "mainARMS: COOcs error\n");
             return ierr;
         }
@@ -82,166 +204,396 @@ int itsol_solver_assemble(ITS_SOLVER *s)
         s->smat.n = A.n;
         s->smat.CS = s->csmat;               /* in row format */
         s->smat.matvec = itsol_matvecCSR;    /* row matvec */
+        s->smat.matvec_mv = itsol_matvecCSR_mv;
+
+        /* ILUK and PARILU refactor in place on new values */
+        if (pctype == ITS_PC_ILUK || pctype == ITS_PC_PARILU)
+            s->cmap = coo_slots(A.n, A.nnz, A.ia);
     }
     else {
         fprintf(log, "solver assemble, wrong preconditioner type\n");
         exit(-1);
     }
 
-    /* pc assemble */
-    itsol_pc_assemble(s);
+    s->stats.t_coo = itsol_get_time() - t;
+
+    /* pc assemble, or read from pcfile */
+    if (pcfile == NULL) {
+        if ((ierr = itsol_pc_assemble(s)) != 0) {
+            fprintf(log, "solver assemble, pc assemble error (%d)\n", ierr);
+            unassemble_(s);
+            return ierr;
+        }
+    }
+    else if ((ierr = load_pc_(s, pcfile)) != 0) {
+        fprintf(log, "solver assemble, cannot load preconditioner from %s (%d)\n", pcfile, ierr);
+
+        itsol_cleanCS(s->csmat);
+        s->csmat = NULL;
+
+        if (s->cmap != NULL) free(s->cmap);
+        s->cmap = NULL;
+
+        memset(&s->smat, 0, sizeof(s->smat));
+        return ierr;
+    }
+
+    /* SELL-C-sigma copy for matvecs, built after the pc since VBILU
+       permutes csmat in place */
+    if (s->pars.sell_sigma > 0 && pctype != ITS_PC_ILUC) {
+        s->smat.SELL = (ITS_SellMat *) itsol_malloc(sizeof(ITS_SellMat), "solver assemble");
+        itsol_csrsellC(s->csmat, s->pars.sell_sigma, s->smat.SELL);
+
+        s->smat.Mtype = 4;
+        s->smat.matvec = itsol_matvecSELL;
+    }
 
     s->assembled = 1;
     return 0;
 }
 
-int itsol_solver_solve(ITS_SOLVER *s, double *x, double *rhs)
+int itsol_solver_assemble(ITS_SOLVER *s)
 {
-    ITS_PARS io;
-    ITS_PC_TYPE pctype;
-    ITS_SOLVER_TYPE stype;
+    return assemble_(s, NULL);
+}
+
+/*----------------------------------------------------------------------
+ * write the preconditioner of s to fname (itsol_pc_save), assembling s
+ * first if needed
+ *
+ * return 0 on success, the error code of the assembly or of
+ * itsol_pc_save otherwise.
+ *--------------------------------------------------------------------*/
+int itsol_solver_save_pc(ITS_SOLVER *s, char *fname)
+{
+    int ierr;
 
     assert(s != NULL);
-    assert(x != NULL);
-    assert(rhs != NULL);
 
-    /* assemble */
-    itsol_solver_assemble(s);
+    if (!s->assembled && (ierr = itsol_solver_assemble(s)) != 0) return ierr;
+
+    return itsol_pc_save(&s->pc, fname);
+}
+
+/*----------------------------------------------------------------------
+ * assemble s with the preconditioner saved in fname by
+ * itsol_solver_save_pc instead of factoring the matrix
+ *----------------------------------------------------------------------
+ * s must be initialized with the pc type and the matrix the
+ * preconditioner was built for, and not yet assembled. The pars that
+ * only drive the factorization are not used; csflat and sell_sigma
+ * still apply to csmat, pc_float and pc_sweeps to the factors read.
+ *
+ * return 0 on success, the error code of itsol_pc_load otherwise (2
+ * also when the preconditioner is of another dimension). s is left
+ * not assembled on error and itsol_solver_assemble can still factor.
+ *--------------------------------------------------------------------*/
+int itsol_solver_load_pc(ITS_SOLVER *s, char *fname)
+{
+    assert(s != NULL);
+    assert(!s->assembled);
+
+    return assemble_(s, fname);
+}
+
+/*----------------------------------------------------------------------
+ * new values for the matrix of an assembled solver
+ *----------------------------------------------------------------------
+ * a = values of the COO matrix given to itsol_solver_initialize, same
+ *     pattern and same order. They are copied into s->A.
+ *
+ * ILUK and PARILU keep csmat, the patterns of L and U (and their level
+ * schedules) and only redo the numeric factorization, unless the
+ * factors are in single precision (pc_float). The other
+ * preconditioners are assembled again from scratch.
+ *
+ * return 0 on success, the error code of the factorization otherwise.
+ * s is then left not assembled: the next itsol_solver_solve factors
+ * the new values again.
+ *--------------------------------------------------------------------*/
+int itsol_solver_update_values(ITS_SOLVER *s, double *a)
+{
+    ITS_CooMat *A;
+    int ierr, *row, *perm;
+    ITS_INT k;
+    double t;
+
+    assert(s != NULL);
+    A = s->A;
+
+    if (a != A->ma)
+        memcpy(A->ma, a, A->nnz * sizeof(double));
+
+    if (!s->assembled) return itsol_solver_assemble(s);
+
+    if ((s->pc_type != ITS_PC_ILUK && s->pc_type != ITS_PC_PARILU) || s->cmap == NULL
+            || s->pars.pc_float) {
+        unassemble_(s);
+        return itsol_solver_assemble(s);
+    }
+
+    /* ILUK, PARILU: values into csmat, numeric factorization only. Rows
+       of csmat are reordered (perm_type), their entries are not. */
+    row = A->ia;
+    perm = s->pc.perm;
+    for (k = 0; k < A->nnz; k++)
+        s->csmat->ma[perm ? perm[row[k]] : row[k]][s->cmap[k]] = A->ma[k];
+
+    if (s->smat.SELL != NULL) itsol_sellvals(s->csmat, s->smat.SELL);
+
+    t = itsol_get_time();
+    if (s->pc_type == ITS_PC_PARILU)
+        ierr = itsol_pc_parilu_num(s->pars.parilu_sweeps, s->csmat, s->pc.ILU, s->pc.log);
+    else
+        ierr = itsol_pc_ilukC_num(s->csmat, s->pc.ILU, s->pars.milu, s->pc.log);
+    s->stats.t_num = itsol_get_time() - t;
+    if (ierr != 0) {
+        fprintf(s->pc.log, "update values, %s error\n", s->pc_type == ITS_PC_PARILU ? "PARILU" : "ILUK");
+        unassemble_(s);
+        return ierr;
+    }
+
+    return 0;
+}
+
+/* block FGMRES on a single right hand side */
+static int bfgmres1_(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
+        int *nits, double *res, ITS_WORK *ws)
+{
+    return itsol_solver_bfgmres(Amat, lu, 1, rhs, sol, io, nits, res, ws);
+}
+
+/*----------------------------------------------------------------------
+ * solve with the solver vectors in work, the permuted vectors in pwork.
+ * own = 1: the pc is applied through a copy of s->pc with its scratch
+ * in pwork too, so that nothing inside s is written.
+ *--------------------------------------------------------------------*/
+static int solve_(ITS_SOLVER *s, double *x, double *rhs, ITS_WORK *work, ITS_WORK *pwork,
+        int *nits, double *res, int own)
+{
+    ITS_PARS io;
+    ITS_PC_TYPE pctype;
+    ITS_SOLVER_TYPE stype;
+    ITS_PC *pc, lpc;
+    ITS_SMat *A, lsmat;
+    int (*solver)(ITS_SMat *, ITS_PC *, double *, double *, ITS_PARS, int *, double *, ITS_WORK *);
+    double *px, *prhs, t = 0;
+    int i, n, rt, *perm, len;
 
     io = s->pars;
     pctype = s->pc_type;
     stype = s->s_type;
 
     if (stype == ITS_SOLVER_FGMRES) {
-        if (pctype == ITS_PC_ILUC || pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT || pctype == ITS_PC_ARMS) {
-            return itsol_solver_fgmres(&s->smat, &s->pc, rhs, x, io, &s->nits, &s->res);
-        }
-        else if (pctype == ITS_PC_VBILUK || pctype == ITS_PC_VBILUT) {
-            if (s->pc.perm == NULL) {
-                return itsol_solver_fgmres(&s->smat, &s->pc, rhs, x, io, &s->nits, &s->res);
-            }
-            else {
-                double *px = NULL, *prhs = NULL;
-                int i, rt;
+        solver = itsol_solver_fgmres_ws;
+    }
+    else if (stype == ITS_SOLVER_BICGSTAB) {
+        solver = itsol_solver_bicgstab_ws;
+    }
+    else if (stype == ITS_SOLVER_BICGSTABL) {
+        solver = itsol_solver_bicgstabl_ws;
+    }
+    else if (stype == ITS_SOLVER_BFGMRES) {
+        solver = bfgmres1_;
+    }
+    else if (stype == ITS_SOLVER_PGMRES) {
+        solver = itsol_solver_pgmres_ws;
+    }
+    else {
+        fprintf(s->log, "wrong solver type\n");
+        exit(-1);
+    }
 
-                px = (double *)itsol_malloc(s->csmat->n * sizeof(double), "main");
-                prhs = (double *)itsol_malloc(s->csmat->n * sizeof(double), "main");
+    if (pctype == ITS_PC_ILUC || pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT || pctype == ITS_PC_ARMS
+            || pctype == ITS_PC_VBILUK || pctype == ITS_PC_VBILUT || pctype == ITS_PC_PARILU) {
+        pc = &s->pc;
+    }
+    else if (pctype == ITS_PC_NONE) {
+        pc = NULL;
+    }
+    else {
+        fprintf(s->pc.log, "wrong preconditioner type\n");
+        exit(-1);
+    }
 
-                for (i = 0; i < s->csmat->n; i++) {
-                    prhs[s->pc.perm[i]] = rhs[i];
-                    px[s->pc.perm[i]] = x[i];
-                }
+    n = s->csmat->n;
+    perm = pc == NULL ? NULL : pc->perm;
 
-                rt = itsol_solver_fgmres(&s->smat, &s->pc, prhs, px, io, &s->nits, &s->res);
+    /* pwork: permuted rhs and solution, then the pc scratch */
+    len = perm == NULL ? 0 : 2 * n;
+    if (own && pc != NULL) {
+        lpc = *pc;
+        lpc.wk = itsol_getWORK(pwork, len + its_max(itsol_pc_worksize(pc), 1)) + len;
+        pc = &lpc;
+    }
+    else if (len > 0) {
+        itsol_getWORK(pwork, len);
+    }
 
-                for (i = 0; i < s->csmat->n; i++) {
-                    rhs[i] = prhs[s->pc.perm[i]];
-                    x[i] = px[s->pc.perm[i]];
-                }
+    /* counters in s->stats, but for the solves with caller-owned work */
+    if (own) {
+        lsmat = s->smat;
+        lsmat.stats = NULL;
+        A = &lsmat;
+    }
+    else {
+        s->smat.stats = &s->stats;
+        A = &s->smat;
+        t = itsol_get_time();
+    }
 
-                free(px);
-                free(prhs);
+    if (perm == NULL) {
+        rt = solver(A, pc, rhs, x, io, nits, res, work);
+    }
+    else {
+        /* matrix and pc are permuted (VBILU): solve for the permuted vectors */
+        prhs = pwork->buf;
+        px = prhs + n;
 
-                return rt;
-            }
-        }
-        else if (pctype == ITS_PC_NONE) {
-            return itsol_solver_fgmres(&s->smat, NULL, rhs, x, io, &s->nits, &s->res);
-        }
-        else {
-            fprintf(s->pc.log, "wrong preconditioner type\n");
-            exit(-1);
+        for (i = 0; i < n; i++) {
+            prhs[perm[i]] = rhs[i];
+            px[perm[i]] = x[i];
         }
+
+        rt = solver(A, pc, prhs, px, io, nits, res, work);
+
+        for (i = 0; i < n; i++)
+            x[i] = px[perm[i]];
     }
-    else if (stype == ITS_SOLVER_BICGSTAB) {
-        if (pctype == ITS_PC_ILUC || pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT || pctype == ITS_PC_ARMS) {
-            return itsol_solver_bicgstab(&s->smat, &s->pc, rhs, x, io, &s->nits, &s->res);
-        }
-        else if (pctype == ITS_PC_VBILUK || pctype == ITS_PC_VBILUT) {
-            if (s->pc.perm == NULL) {
-                return itsol_solver_bicgstab(&s->smat, &s->pc, rhs, x, io, &s->nits, &s->res);
-            }
-            else {
-                double *px = NULL, *prhs = NULL;
-                int i, rt;
 
-                px = (double *)itsol_malloc(s->csmat->n * sizeof(double), "main");
-                prhs = (double *)itsol_malloc(s->csmat->n * sizeof(double), "main");
+    if (!own) {
+        s->stats.t_solve += itsol_get_time() - t;
+        s->stats.nsolve++;
+    }
 
-                for (i = 0; i < s->csmat->n; i++) {
-                    prhs[s->pc.perm[i]] = rhs[i];
-                    px[s->pc.perm[i]] = x[i];
-                }
+    return rt;
+}
 
-                rt = itsol_solver_bicgstab(&s->smat, &s->pc, prhs, px, io, &s->nits, &s->res);
+int itsol_solver_solve(ITS_SOLVER *s, double *x, double *rhs)
+{
+    int ierr;
 
-                for (i = 0; i < s->csmat->n; i++) {
-                    rhs[i] = prhs[s->pc.perm[i]];
-                    x[i] = px[s->pc.perm[i]];
-                }
+    assert(s != NULL);
+    assert(x != NULL);
+    assert(rhs != NULL);
 
-                free(px);
-                free(prhs);
+    /* assemble */
+    if ((ierr = itsol_solver_assemble(s)) != 0) return ierr;
 
-                return rt;
-            }
-        }
-        else if (pctype == ITS_PC_NONE) {
-            return itsol_solver_bicgstab(&s->smat, NULL, rhs, x, io, &s->nits, &s->res);
-        }
-        else {
-            fprintf(s->pc.log, "wrong preconditioner type\n");
-            exit(-1);
-        }
-    }
-    else if (stype == ITS_SOLVER_BICGSTABL) {
-        if (pctype == ITS_PC_ILUC || pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT || pctype == ITS_PC_ARMS) {
-            return itsol_solver_bicgstabl(&s->smat, &s->pc, rhs, x, io, &s->nits, &s->res);
-        }
-        else if (pctype == ITS_PC_VBILUK || pctype == ITS_PC_VBILUT) {
-            if (s->pc.perm == NULL) {
-                return itsol_solver_bicgstabl(&s->smat, &s->pc, rhs, x, io, &s->nits, &s->res);
-            }
-            else {
-                double *px = NULL, *prhs = NULL;
-                int i, rt;
+    /* work vectors of the solver are kept in s between solves */
+    return solve_(s, x, rhs, &s->work, &s->pwork, &s->nits, &s->res, 0);
+}
 
-                px = (double *)itsol_malloc(s->csmat->n * sizeof(double), "main");
-                prhs = (double *)itsol_malloc(s->csmat->n * sizeof(double), "main");
+/*----------------------------------------------------------------------
+ * solve with caller-owned work space
+ *----------------------------------------------------------------------
+ * Same as itsol_solver_solve, but every vector written during the solve
+ * lives in work and pwork and the matrix and preconditioner are only
+ * read: several threads can solve with the same assembled solver at the
+ * same time, each with its own work, pwork (zero-initialized ITS_WORK,
+ * released with itsol_cleanWORK).
+ *
+ * s must be assembled (itsol_solver_assemble) before the threads start.
+ * nits, res = iteration count and residual of this solve, or NULL.
+ *--------------------------------------------------------------------*/
+int itsol_solver_solve_ws(ITS_SOLVER *s, double *x, double *rhs, ITS_WORK *work, ITS_WORK *pwork,
+        int *nits, double *res)
+{
+    int lnits, ierr;
 
-                for (i = 0; i < s->csmat->n; i++) {
-                    prhs[s->pc.perm[i]] = rhs[i];
-                    px[s->pc.perm[i]] = x[i];
-                }
+    assert(s != NULL);
+    assert(x != NULL);
+    assert(rhs != NULL);
+    assert(work != NULL && pwork != NULL);
 
-                rt = itsol_solver_bicgstabl(&s->smat, &s->pc, prhs, px, io, &s->nits, &s->res);
+    if ((ierr = itsol_solver_assemble(s)) != 0) return ierr;
 
-                for (i = 0; i < s->csmat->n; i++) {
-                    rhs[i] = prhs[s->pc.perm[i]];
-                    x[i] = px[s->pc.perm[i]];
-                }
+    return solve_(s, x, rhs, work, pwork, nits != NULL ? nits : &lnits, res, 1);
+}
+
+/*----------------------------------------------------------------------
+ * solve for p right hand sides at once
+ *----------------------------------------------------------------------
+ * X, B = p vectors of length n, stored interleaved: entry i of vector j
+ *        is X[i * p + j]. X holds the initial guesses on entry.
+ *
+ * ITS_SOLVER_BFGMRES iterates on all the columns together, with one
+ * matvec and one preconditioner apply per step for the whole block.
+ * The other solvers go through the columns one by one.
+ *
+ * s->nits = steps of the slowest column, s->res = largest residual.
+ * return 0 when every column converged, 1 otherwise, the error code of
+ * the assembly if it fails.
+ *--------------------------------------------------------------------*/
+int itsol_solver_solve_block(ITS_SOLVER *s, int p, double *X, double *B)
+{
+    ITS_PC *pc;
+    double *x, *b, res, t;
+    int i, j, n, rt, nits, *perm;
+
+    assert(s != NULL);
+    assert(X != NULL);
+    assert(B != NULL);
+    assert(p > 0);
+
+    if ((rt = itsol_solver_assemble(s)) != 0) return rt;
+
+    n = s->csmat->n;
 
-                free(px);
-                free(prhs);
+    if (s->s_type != ITS_SOLVER_BFGMRES) {
+        x = (double *)itsol_malloc(2 * n * sizeof(double), "solve block");
+        b = x + n;
 
-                return rt;
+        rt = 0;
+        s->nits = 0;
+        s->res = 0.0;
+        for (j = 0; j < p; j++) {
+            for (i = 0; i < n; i++) {
+                x[i] = X[(size_t)i * p + j];
+                b[i] = B[(size_t)i * p + j];
             }
+
+            rt |= solve_(s, x, b, &s->work, &s->pwork, &nits, &res, 0);
+            s->nits = its_max(s->nits, nits);
+            s->res = its_max(s->res, res);
+
+            for (i = 0; i < n; i++)
+                X[(size_t)i * p + j] = x[i];
         }
-        else if (pctype == ITS_PC_NONE) {
-            return itsol_solver_bicgstabl(&s->smat, NULL, rhs, x, io, &s->nits, &s->res);
-        }
-        else {
-            fprintf(s->pc.log, "wrong preconditioner type\n");
-            exit(-1);
-        }
+
+        free(x);
+        return rt;
+    }
+
+    pc = s->pc_type == ITS_PC_NONE ? NULL : &s->pc;
+    perm = pc == NULL ? NULL : pc->perm;
+
+    s->smat.stats = &s->stats;
+    t = itsol_get_time();
+
+    if (perm == NULL) {
+        rt = itsol_solver_bfgmres(&s->smat, pc, p, B, X, s->pars, &s->nits, &s->res, &s->work);
     }
     else {
-        fprintf(s->log, "wrong solver type\n");
-        exit(-1);
+        /* matrix and pc are permuted (VBILU): move whole block rows */
+        b = itsol_getWORK(&s->pwork, (ITS_INT)2 * n * p);
+        x = b + (size_t)n * p;
+
+        for (i = 0; i < n; i++) {
+            memcpy(b + (size_t)perm[i] * p, B + (size_t)i * p, p * sizeof(double));
+            memcpy(x + (size_t)perm[i] * p, X + (size_t)i * p, p * sizeof(double));
+        }
+
+        rt = itsol_solver_bfgmres(&s->smat, pc, p, b, x, s->pars, &s->nits, &s->res, &s->work);
+
+        for (i = 0; i < n; i++)
+            memcpy(X + (size_t)i * p, x + (size_t)perm[i] * p, p * sizeof(double));
     }
 
+    s->stats.t_solve += itsol_get_time() - t;
+    s->stats.nsolve += p;
 
-    return 0;
+    return rt;
 }
 
 void itsol_pc_initialize(ITS_PC *pc, ITS_PC_TYPE pctype)
@@ -250,7 +602,8 @@ void itsol_pc_initialize(ITS_PC *pc, ITS_PC_TYPE pctype)
 
     pc->pc_type = pctype;
 
-    if (pctype == ITS_PC_ILUC || pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT) {
+    if (pctype == ITS_PC_ILUC || pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT
+            || pctype == ITS_PC_PARILU) {
         pc->ILU = (ITS_ILUSpar *) itsol_malloc(sizeof(ITS_ILUSpar), "pc init");
     }
     else if (pctype == ITS_PC_VBILUK || pctype == ITS_PC_VBILUT) {
@@ -272,9 +625,13 @@ void itsol_pc_finalize(ITS_PC *pc)
     if (pc == NULL) return;
 
     pctype = pc->pc_type;
-    if (pctype == ITS_PC_ILUC || pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT) {
+    if (pctype == ITS_PC_ILUC || pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT
+            || pctype == ITS_PC_PARILU) {
         itsol_cleanILU(pc->ILU);
         pc->ILU = NULL;
+
+        if (pc->perm != NULL) free(pc->perm);
+        pc->perm = NULL;
     }
     else if (pctype == ITS_PC_VBILUK || pctype == ITS_PC_VBILUT) {
         itsol_cleanVBILU(pc->VBILU);
@@ -293,42 +650,151 @@ void itsol_pc_finalize(ITS_PC *pc)
     }
 }
 
+/*----------------------------------------------------------------------
+ * length (doubles) of the scratch an assembled pc needs in ITS_PC.wk to
+ * be applied without touching the buffers of its factors.
+ *--------------------------------------------------------------------*/
+int itsol_pc_worksize(ITS_PC *pc)
+{
+    int i, len = 0;
+
+    if (pc->pc_type == ITS_PC_ARMS) {
+        len = pc->ARMS->n;
+    }
+    else if (pc->pc_type == ITS_PC_ILUK || pc->pc_type == ITS_PC_ILUT
+            || pc->pc_type == ITS_PC_PARILU) {
+        if (pc->ILU->nsweep > 0) len = 2 * pc->ILU->n;
+    }
+    else if (pc->pc_type == ITS_PC_VBILUK || pc->pc_type == ITS_PC_VBILUT) {
+        for (i = 0; i < pc->VBILU->n; i++)
+            len = its_max(len, ITS_B_DIM(pc->VBILU->bsz, i));
+    }
+
+    return len;
+}
+
+/* perm of the ordering selected by perm_type (ITS_PERM_*) for the ILU
+   preconditioners, or NULL for the natural order. Returns 1 if there
+   is one. The subdomains of nested dissection go to ndom, dom (NULL
+   for the others). */
+static int order_(ITS_SparMat *csmat, ITS_PARS *p, int **perm, int *ndom, int **dom)
+{
+    int nc, perm_type = p->perm_type;
+
+    *perm = NULL;
+    *ndom = 0;
+    *dom = NULL;
+    if (perm_type != ITS_PERM_MC && perm_type != ITS_PERM_RCM && perm_type != ITS_PERM_AMD
+            && perm_type != ITS_PERM_ND)
+        return 0;
+
+    *perm = (int *)itsol_malloc(csmat->n * sizeof(int), "pc order");
+    switch (perm_type) {
+        case ITS_PERM_MC:
+            itsol_mcolor(csmat, *perm, &nc);
+            break;
+        case ITS_PERM_RCM:
+            itsol_rcm(csmat, *perm);
+            break;
+        case ITS_PERM_AMD:
+            itsol_amd(csmat, *perm);
+            break;
+        default:
+            itsol_nd(csmat, p->nd_level, *perm, ndom, dom);
+    }
+
+    return 1;
+}
+
 int itsol_pc_assemble(ITS_SOLVER *s)
 {
     ITS_PC_TYPE pctype;
-    int ierr;
+    int ierr, ndom = 0, *dom = NULL;
     ITS_PARS p;
     ITS_PC *pc;
+    ITS_STATS *st;
+    double t;
 
     assert(s != NULL);
     pc = &s->pc;
+    st = &s->stats;
 
     /* type */
     pctype = pc->pc_type;
     p = s->pars;
 
+    st->t_order = st->t_symb = st->t_num = 0.;
+    st->nnz_pc = 0;
+    t = itsol_get_time();
+
+    /* symmetric ordering of csmat for the ILU factors, the solves take
+       the vectors through pc->perm as for VBILU */
+    if ((pctype == ITS_PC_ILUK || pctype == ITS_PC_ILUT || pctype == ITS_PC_PARILU)
+            && order_(s->csmat, &p, &pc->perm, &ndom, &dom) != 0) {
+        if (itsol_dpermC(s->csmat, pc->perm) != 0) {
+            fprintf(pc->log, "*** dpermC error ***\n");
+            exit(9);
+        }
+        st->t_order = itsol_get_time() - t;
+        t = itsol_get_time();
+    }
+
     if (pctype == ITS_PC_ILUC) {
         pc->precon = itsol_preconLDU;
     }
     else if (pctype == ITS_PC_ILUK) {
-      ierr = itsol_pc_ilukC(p.iluk_level, s->csmat, pc->ILU, p.milu, pc->log);
+        ierr = itsol_pc_ilukC_symb_nd(p.iluk_level, s->csmat, pc->ILU, ndom, dom, pc->log);
+        st->t_symb = itsol_get_time() - t;
+        free(dom);  /* the factors keep a copy */
+
+        if (ierr == 0) {
+            t = itsol_get_time();
+            ierr = itsol_pc_ilukC_num(s->csmat, pc->ILU, p.milu, pc->log);
+            st->t_num = itsol_get_time() - t;
+        }
 
         if (ierr != 0) {
             fprintf(pc->log, "pc assemble, ILUK error\n");
             return ierr;
         }
+        st->nnz_pc = itsol_nnz_ilu(pc->ILU);
 
         pc->precon = itsol_preconILU;
+        pc->precon_mv = itsol_preconILU_mv;
+    }
+    else if (pctype == ITS_PC_PARILU) {
+        ierr = itsol_pc_ilukC_symb_nd(p.iluk_level, s->csmat, pc->ILU, ndom, dom, pc->log);
+        st->t_symb = itsol_get_time() - t;
+        free(dom);
+
+        if (ierr == 0) {
+            t = itsol_get_time();
+            ierr = itsol_pc_parilu_num(p.parilu_sweeps, s->csmat, pc->ILU, pc->log);
+            st->t_num = itsol_get_time() - t;
+        }
+
+        if (ierr != 0) {
+            fprintf(pc->log, "pc assemble, PARILU error\n");
+            return ierr;
+        }
+        st->nnz_pc = itsol_nnz_ilu(pc->ILU);
+
+        pc->precon = itsol_preconILU;
+        pc->precon_mv = itsol_preconILU_mv;
     }
     else if (pctype == ITS_PC_ILUT) {
-        ierr = itsol_pc_ilut(s->csmat, pc->ILU, p.ilut_p, p.ilut_tol, pc->log);
+        ierr = itsol_pc_ilut_nd(s->csmat, pc->ILU, p.ilut_p, p.ilut_tol, ndom, dom, pc->log);
+        st->t_num = itsol_get_time() - t;
+        free(dom);
 
         if (ierr != 0) {
             fprintf(pc->log, "pc assemble, ILUK error\n");
             return ierr;
         }
+        st->nnz_pc = itsol_nnz_ilu(pc->ILU);
 
         pc->precon = itsol_preconILU;
+        pc->precon_mv = itsol_preconILU_mv;
     }
     else if (pctype == ITS_PC_VBILUK) {
         int nBlock, *nB = NULL, *perm = NULL;
@@ -356,11 +822,17 @@ int itsol_pc_assemble(ITS_SOLVER *s)
         }
 
         /* fac */
+        st->t_order = itsol_get_time() - t;
+        t = itsol_get_time();
         ierr = itsol_pc_vbilukC(p.iluk_level, vbmat, pc->VBILU, pc->log);
+        st->t_num = itsol_get_time() - t;
         if (ierr != 0) {
             fprintf(pc->log, "pc assemble in vbilukC ierr != 0 ***\n");
-            exit(10);
+            itsol_cleanVBMat(vbmat);
+            free(nB);
+            return ierr;
         }
+        st->nnz_pc = itsol_nnz_vbilu(pc->VBILU);
 
         pc->precon = itsol_preconVBR;
 
@@ -397,6 +869,8 @@ int itsol_pc_assemble(ITS_SOLVER *s)
         }
 
         /* fac */
+        st->t_order = itsol_get_time() - t;
+        t = itsol_get_time();
         lfil = p.ilut_p;
         tol = p.ilut_tol;
         w = (ITS_BData *) itsol_malloc(vbmat->n * sizeof(ITS_BData), "main");
@@ -406,10 +880,16 @@ int itsol_pc_assemble(ITS_SOLVER *s)
         }
 
         ierr = itsol_pc_vbilutC(vbmat, pc->VBILU, lfil, tol, w, pc->log);
+        st->t_num = itsol_get_time() - t;
         if (ierr != 0) {
             fprintf(pc->log, "pc assemble in vbilutC ierr != 0 ***\n");
-            exit(10);
+            for (i = 0; i < vbmat->n; i++) free(w[i]);
+            free(w);
+            itsol_cleanVBMat(vbmat);
+            free(nB);
+            return ierr;
         }
+        st->nnz_pc = itsol_nnz_vbilu(pc->VBILU);
 
         pc->precon = itsol_preconVBR;
 
@@ -426,11 +906,13 @@ int itsol_pc_assemble(ITS_SOLVER *s)
 
         /* assemble */
         ierr = itsol_pc_arms2(s->csmat, p.ipar, p.droptol, p.lfil_arr, p.tolind, pc->ARMS, pc->log);
+        st->t_num = itsol_get_time() - t;
 
         if (ierr != 0) {
             fprintf(pc->log, "pc assemble, arms error\n");
             return ierr;
         }
+        st->nnz_pc = itsol_nnz_arms(pc->ARMS, NULL);
 
         pc->precon = itsol_preconARMS;
     }
@@ -439,10 +921,105 @@ int itsol_pc_assemble(ITS_SOLVER *s)
         exit(-1);
     }
 
+    if (p.pc_float) {
+        t = itsol_get_time();
+        itsol_pc_float(pc);
+        st->t_num += itsol_get_time() - t;
+    }
+    itsol_pc_sweeps(pc, p.pc_sweeps);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+ * factor values of an assembled pc in single precision (pc_float):
+ * L and U of ILUK / ILUT / PARILU and of VBILUK / VBILUT, and L, U,
+ * E, F of each ARMS level with the factors of the last Schur
+ * complement. The diagonals (D of ILU, the inverted diagonal blocks of
+ * VBILU), the scalings and the vectors of the solves stay double. ILUC
+ * is left as it is.
+ *--------------------------------------------------------------------*/
+int itsol_pc_float(ITS_PC *pc)
+{
+    ITS_Per4Mat *lev;
+    int k;
+
+    if (pc->pc_type == ITS_PC_ILUK || pc->pc_type == ITS_PC_ILUT
+            || pc->pc_type == ITS_PC_PARILU) {
+        itsol_csfloat(pc->ILU->L);
+        itsol_csfloat(pc->ILU->U);
+    }
+    else if (pc->pc_type == ITS_PC_VBILUK || pc->pc_type == ITS_PC_VBILUT) {
+        itsol_vbfloat(pc->VBILU->L, pc->VBILU->bsz);
+        itsol_vbfloat(pc->VBILU->U, pc->VBILU->bsz);
+    }
+    else if (pc->pc_type == ITS_PC_ARMS) {
+        lev = pc->ARMS->levmat;
+        for (k = 0; k < pc->ARMS->nlev; k++, lev = lev->next) {
+            itsol_csfloat(lev->L);
+            itsol_csfloat(lev->U);
+            itsol_csfloat(lev->E);
+            itsol_csfloat(lev->F);
+        }
+        itsol_csfloat(pc->ARMS->ilus->L);
+        itsol_csfloat(pc->ARMS->ilus->U);
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+ * apply mode of an assembled ILUK / ILUT / PARILU pc: nsweep > 0
+ * replaces the forward and backward substitutions by nsweep Jacobi
+ * sweeps on L and U (see itsol_lusolC_r), 0 goes back to the exact
+ * solves. The sweeps are applied one vector at a time, so precon_mv is
+ * dropped. Other pc types keep their exact solves.
+ *--------------------------------------------------------------------*/
+int itsol_pc_sweeps(ITS_PC *pc, int nsweep)
+{
+    ITS_ILUSpar *lu;
+
+    if (pc->pc_type != ITS_PC_ILUK && pc->pc_type != ITS_PC_ILUT
+            && pc->pc_type != ITS_PC_PARILU) return 0;
+
+    lu = pc->ILU;
+    lu->nsweep = its_max(nsweep, 0);
+
+    if (lu->swk != NULL) free(lu->swk);
+    lu->swk = NULL;
+
+    if (lu->nsweep > 0) {
+        lu->swk = (double *)itsol_malloc(2 * lu->n * sizeof(double), "pc_sweeps");
+        pc->precon_mv = NULL;
+    }
+    else {
+        pc->precon_mv = itsol_preconILU_mv;
+    }
+
     return 0;
 }
 
 
+/*----------------------------------------------------------------------
+ * print s->stats: setup phases of the last factorization, then the
+ * solves since the struct was last zeroed
+ *--------------------------------------------------------------------*/
+void itsol_solver_print_stats(ITS_SOLVER *s, FILE *fp)
+{
+    ITS_STATS *st;
+
+    assert(s != NULL);
+    if (fp == NULL) return;
+
+    st = &s->stats;
+    fprintf(fp, "setup:  coo->csr %10.3e s  order %10.3e s  symbolic %10.3e s  numeric %10.3e s\n",
+            st->t_coo, st->t_order, st->t_symb, st->t_num);
+    fprintf(fp, "        nnz(A) %" ITS_INT_FMT "  nnz(pc) %" ITS_INT_FMT "\n",
+            s->csmat != NULL ? itsol_nnz_cs(s->csmat) : 0, st->nnz_pc);
+    fprintf(fp, "solves: %d in %10.3e s  matvec %10.3e s (%ld)  precon %10.3e s (%ld)  dots %ld\n",
+            st->nsolve, st->t_solve, st->t_matvec, st->nmatvec, st->t_precon, st->nprecon, st->ndot);
+}
+
 void itsol_solver_set_pars(ITS_SOLVER *s, ITS_PARS par)
 {
     ITS_PARS *p;
@@ -475,13 +1052,25 @@ void itsol_solver_init_pars(ITS_PARS *p)
     p->iluk_level = 1;             /* initial level of fill for ILUK  */
 
     /* value always set to 1           */
-    p->perm_type = 0;              /* indset perms (0) or PQ perms (1)*/
+    p->perm_type = ITS_PERM_NONE;  /* ARMS indset perms, ILU: natural */
     p->Bsize = 30;                 /* block size - dual role. see input file */
 
     /* arms */
     p->diagscal = 1;
     p->tolind = ITS_TOL_DD;
 
+#ifdef ITSOL_USE_OPENMP
+    p->csflat = 1;                 /* flat CSR: nnz-balanced threads  */
+#else
+    p->csflat = 0;                 /* CSR rows stored separately      */
+#endif
+    p->sell_sigma = 0;             /* matvecs in CSR                  */
+    p->pc_float = 0;               /* factors in double precision     */
+    p->pc_sweeps = 0;              /* exact triangular solves         */
+    p->parilu_sweeps = 3;          /* fixed-point sweeps of PARILU    */
+    p->nd_level = 4;               /* nested dissection: 16 subdomains */
+    p->indset_nchunk = 0;          /* ARMS: serial independent sets   */
+
     /* init arms pars */
     itsol_set_arms_pars(p, p->diagscal, p->ipar, p->dropcoef, p->lfil_arr);
 }
@@ -1,6 +1,13 @@
 
 #include "mat-utils.h"
 
+#ifdef ITSOL_USE_OPENMP
+#include <omp.h>
+#endif
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
 #define TOL 1.e-17
 
 int itsol_CondestC(ITS_ILUSpar *lu, FILE * fp)
@@ -249,6 +256,165 @@ int itsol_diagvec(ITS_VBSparMat *vbmat, ITS_BData x, ITS_BData y)
     return 0;
 }
 
+/*---------------------------------------------------------------------
+  | Row kernel of itsol_matvecz: z = y - A x for the rows i0 <= i < i1,
+  | each entry subtracted from y[i] in turn.
+  |--------------------------------------------------------------------*/
+static void ymaxz_rows(ITS_SparMat *A, double *x, double *y, double *z, int i0, int i1)
+{
+    int i, k, *ki;
+    double *kr, t;
+
+    if (A->ia && A->ma) {
+        ITS_INT *ia = A->ia, kk;
+        int *ja = A->jflat;
+        double *ma = A->mflat;
+
+        for (i = i0; i < i1; i++) {
+            t = y[i];
+            for (kk = ia[i]; kk < ia[i + 1]; kk++) t -= ma[kk] * x[ja[kk]];
+            z[i] = t;
+        }
+        return;
+    }
+
+    /* single precision values (itsol_csfloat) */
+    if (A->fa) {
+        float *fr;
+
+        for (i = i0; i < i1; i++) {
+            t = y[i];
+            fr = A->fa[i];
+            ki = A->ja[i];
+            for (k = 0; k < A->nzcount[i]; k++) t -= fr[k] * x[ki[k]];
+            z[i] = t;
+        }
+        return;
+    }
+
+    for (i = i0; i < i1; i++) {
+        kr = A->ma[i];
+        ki = A->ja[i];
+        t = y[i];
+
+        for (k = 0; k < A->nzcount[i]; k++)
+            t -= kr[k] * x[ki[k]];
+
+        z[i] = t;
+    }
+}
+
+/*---------------------------------------------------------------------
+  | Row kernel of the matvec family: z = a * A x + b * y for the rows
+  | i0 <= i < i1. y is not read when b == 0. With sub, z = y - A x
+  | (ymaxz_rows), a and b are not used.
+  |--------------------------------------------------------------------*/
+static void amxpbyz_rows(double a, ITS_SparMat *A, double *x, double b, double *y, double *z,
+        int sub, int i0, int i1)
+{
+    int i, k, *ki;
+    double *kr, t;
+
+    if (sub) {
+        ymaxz_rows(A, x, y, z, i0, i1);
+        return;
+    }
+
+    if (A->ia && A->ma) {
+        ITS_INT *ia = A->ia, kk;
+        int *ja = A->jflat;
+        double *ma = A->mflat;
+
+        for (i = i0; i < i1; i++) {
+            t = 0.;
+            for (kk = ia[i]; kk < ia[i + 1]; kk++) t += ma[kk] * x[ja[kk]];
+            z[i] = b == 0. ? t * a : t * a + y[i] * b;
+        }
+        return;
+    }
+
+    /* single precision values (itsol_csfloat) */
+    if (A->fa) {
+        float *fr;
+
+        for (i = i0; i < i1; i++) {
+            t = 0.;
+            fr = A->fa[i];
+            ki = A->ja[i];
+            for (k = 0; k < A->nzcount[i]; k++) t += fr[k] * x[ki[k]];
+            z[i] = b == 0. ? t * a : t * a + y[i] * b;
+        }
+        return;
+    }
+
+    for (i = i0; i < i1; i++) {
+        t = 0.;
+        kr = A->ma[i];
+        ki = A->ja[i];
+
+        for (k = 0; k < A->nzcount[i]; k++) t += kr[k] * x[ki[k]];
+
+        z[i] = b == 0. ? t * a : t * a + y[i] * b;
+    }
+}
+
+/*---------------------------------------------------------------------
+  | first row of part t out of nparts when the rows of a flat matrix
+  | are split into parts with (about) the same number of nonzeros.
+  |--------------------------------------------------------------------*/
+static int nnz_split(ITS_INT *ia, int n, int t, int nparts)
+{
+    int lo = 0, hi = n, mid;
+    double target = (double)ia[n] * t / nparts;
+
+    if (t >= nparts) return n;
+
+    /* first row i with ia[i] >= target */
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (ia[mid] < target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*---------------------------------------------------------------------
+  | z = a * A x + b * y (z = y - A x with sub), threaded when built with
+  | ITSOL_USE_OPENMP.
+  | Flat matrices are split between threads by nonzero count,
+  | row-wise matrices are scheduled dynamically in chunks of rows.
+  |--------------------------------------------------------------------*/
+static void amxpbyz_(double a, ITS_SparMat *A, double *x, double b, double *y, double *z, int sub)
+{
+#ifdef ITSOL_USE_OPENMP
+    int n = A->n;
+
+    if (omp_get_max_threads() > 1 && !omp_in_parallel()) {
+        if (A->ia && A->ia[n] >= ITS_OMP_MIN_NNZ) {
+#pragma omp parallel
+            {
+                int nt = omp_get_num_threads(), t = omp_get_thread_num();
+
+                amxpbyz_rows(a, A, x, b, y, z, sub, nnz_split(A->ia, n, t, nt),
+                        nnz_split(A->ia, n, t + 1, nt));
+            }
+            return;
+        }
+        else if (A->ia == NULL && n >= ITS_OMP_MIN_ROWS) {
+            int i0;
+
+#pragma omp parallel for schedule(dynamic)
+            for (i0 = 0; i0 < n; i0 += ITS_OMP_ROW_CHUNK)
+                amxpbyz_rows(a, A, x, b, y, z, sub, i0, its_min(i0 + ITS_OMP_ROW_CHUNK, n));
+            return;
+        }
+    }
+#endif
+    amxpbyz_rows(a, A, x, b, y, z, sub, 0, A->n);
+}
+
 /*---------------------------------------------------------------------
   | This function does the matrix vector product y = A x.
   |----------------------------------------------------------------------
@@ -261,65 +427,32 @@ int itsol_diagvec(ITS_VBSparMat *vbmat, ITS_BData x, ITS_BData y)
   |--------------------------------------------------------------------*/
 void itsol_matvec(ITS_SparMat *A, double *x, double *y)
 {
-    int i, k, *ki;
-    double *kr;
-
     assert(A != NULL);
     assert(x != NULL);
     assert(y != NULL);
 
-    for (i = 0; i < A->n; i++) {
-        y[i] = 0.0;
-        kr = A->ma[i];
-        ki = A->ja[i];
-
-        for (k = 0; k < A->nzcount[i]; k++) y[i] += kr[k] * x[ki[k]];
-    }
+    amxpbyz_(1., A, x, 0., NULL, y, 0);
 }
 
 /* y = a * Ax + b * y*/
 void itsol_amxpby(double a, ITS_SparMat *A, double *x, double b, double *y)
 {
-    int i, k, *ki;
-    double *kr;
-
     assert(A != NULL);
     assert(x != NULL);
     assert(y != NULL);
 
-    for (i = 0; i < A->n; i++) {
-        double t = 0.;
-
-        kr = A->ma[i];
-        ki = A->ja[i];
-
-        for (k = 0; k < A->nzcount[i]; k++) t += kr[k] * x[ki[k]];
-
-        y[i] = t * a + y[i] * b;
-    }
+    amxpbyz_(a, A, x, b, y, y, 0);
 }
 
 /* z = a * Ax + b * y*/
 void itsol_amxpbyz(double a, ITS_SparMat *A, double *x, double b, double *y, double *z)
 {
-    int i, k, *ki;
-    double *kr;
-
     assert(A != NULL);
     assert(x != NULL);
     assert(y != NULL);
     assert(z != NULL);
 
-    for (i = 0; i < A->n; i++) {
-        double t = 0.;
-
-        kr = A->ma[i];
-        ki = A->ja[i];
-
-        for (k = 0; k < A->nzcount[i]; k++) t += kr[k] * x[ki[k]];
-
-        z[i] = t * a + y[i] * b;
-    }
+    amxpbyz_(a, A, x, b, y, z, 0);
 }
 
 void itsol_vbmatvec(ITS_VBSparMat *vbmat, double *x, double *y)
@@ -349,6 +482,96 @@ void itsol_vbmatvec(ITS_VBSparMat *vbmat, double *x, double *y)
     }
 }
 
+/*---------------------------------------------------------------------
+  | row kernels of the triangular solves, shared by the sequential
+  | sweeps and the level-scheduled ones.
+  | lsol_row: x[i] = b[i] - L(i,:) x
+  | usol_row: x[i] = (b[i] - U(i,:) x) * d, with d = D[i] and all
+  |           entries of the row when D is given (ILU factors), or
+  |           d = ma[i][0] and the entries after it (ARMS factors).
+  | Factors with single precision values (fa) are read as float, the
+  | sums are in double.
+  |--------------------------------------------------------------------*/
+static inline void lsol_row(ITS_SparMat *L, double *b, double *x, int i)
+{
+    int k, *ki = L->ja[i];
+    double t = b[i];
+
+    if (L->fa) {
+        float *fr = L->fa[i];
+
+        for (k = 0; k < L->nzcount[i]; k++)
+            t -= fr[k] * x[ki[k]];
+    }
+    else {
+        double *kr = L->ma[i];
+
+        for (k = 0; k < L->nzcount[i]; k++)
+            t -= kr[k] * x[ki[k]];
+    }
+    x[i] = t;
+}
+
+static inline void usol_row(ITS_SparMat *U, double *D, double *b, double *x, int i)
+{
+    int k, *ki = U->ja[i];
+    double t = b[i];
+
+    if (U->fa) {
+        float *fr = U->fa[i];
+
+        for (k = (D == NULL); k < U->nzcount[i]; k++)
+            t -= fr[k] * x[ki[k]];
+        x[i] = t * (D == NULL ? fr[0] : D[i]);
+    }
+    else {
+        double *kr = U->ma[i];
+
+        for (k = (D == NULL); k < U->nzcount[i]; k++)
+            t -= kr[k] * x[ki[k]];
+        x[i] = t * (D == NULL ? kr[0] : D[i]);
+    }
+}
+
+#ifdef ITSOL_USE_OPENMP
+/*---------------------------------------------------------------------
+  | level-scheduled solves: the rows of a level are independent, one
+  | barrier per level. Only used when the factor has a schedule (see
+  | itsol_levsched) and we are not already inside a parallel region.
+  | Can be done in place (b == x) as the sequential sweeps.
+  |--------------------------------------------------------------------*/
+static int lev_par(ITS_SparMat *T)
+{
+    return T->sched != NULL && omp_get_max_threads() > 1 && !omp_in_parallel();
+}
+
+static void lsol_lev(ITS_SparMat *L, double *b, double *x)
+{
+    ITS_LevSched *sc = L->sched;
+    int l, k;
+
+#pragma omp parallel private(l, k)
+    for (l = 0; l < sc->nlev; l++) {
+#pragma omp for schedule(static)
+        for (k = sc->lev[l]; k < sc->lev[l + 1]; k++)
+            lsol_row(L, b, x, sc->rows[k]);
+    }
+}
+
+static void usol_lev(ITS_SparMat *U, double *D, double *b, double *x)
+{
+    ITS_LevSched *sc = U->sched;
+    int l, k;
+
+#pragma omp parallel private(l, k)
+    for (l = 0; l < sc->nlev; l++) {
+#pragma omp for schedule(static)
+        for (k = sc->lev[l]; k < sc->lev[l + 1]; k++)
+            usol_row(U, D, b, x, sc->rows[k]);
+    }
+}
+#endif
+
 /*---------------------------------------------------------------------
   | This function does the forward solve L x = b.
   | Can be done in place.
@@ -362,21 +585,17 @@ void itsol_vbmatvec(ITS_VBSparMat *vbmat, double *x, double *y)
   |--------------------------------------------------------------------*/
 void itsol_Lsol(ITS_SparMat *mata, double *b, double *x)
 {
-    int i, k;
-    double *kr;
-    int *ki;
-
-    for (i = 0; i < mata->n; i++) {
-        x[i] = b[i];
-
-        if (mata->nzcount[i] > 0) {
-            kr = mata->ma[i];
-            ki = mata->ja[i];
+    int i;
 
-            for (k = 0; k < mata->nzcount[i]; k++)
-                x[i] -= kr[k] * x[ki[k]];
-        }
+#ifdef ITSOL_USE_OPENMP
+    if (lev_par(mata)) {
+        lsol_lev(mata, b, x);
+        return;
     }
+#endif
+
+    for (i = 0; i < mata->n; i++)
+        lsol_row(mata, b, x, i);
 }
 
 /*---------------------------------------------------------------------
@@ -393,20 +612,62 @@ void itsol_Lsol(ITS_SparMat *mata, double *b, double *x)
   |---------------------------------------------------------------------*/
 void itsol_Usol(ITS_SparMat *mata, double *b, double *x)
 {
-    int i, k, *ki;
-    double *kr;
+    int i;
+
+#ifdef ITSOL_USE_OPENMP
+    if (lev_par(mata)) {
+        usol_lev(mata, NULL, b, x);
+        return;
+    }
+#endif
+
+    for (i = mata->n - 1; i >= 0; i--)
+        usol_row(mata, NULL, b, x, i);
+}
 
-    for (i = mata->n - 1; i >= 0; i--) {
-        kr = mata->ma[i];
-        ki = mata->ja[i];
-        x[i] = b[i];
+#ifdef ITSOL_USE_OPENMP
+/*---------------------------------------------------------------------
+  | block solves of an ARMS level: L and U are block diagonal (the
+  | blocks of itsol_pc_pilu, levmat->blk), a thread solves whole blocks
+  | with L then U without a barrier in between. Same operations in the
+  | same order as the sequential sweeps.
+  |--------------------------------------------------------------------*/
+static int blk_par(ITS_Per4Mat *levmat)
+{
+    return levmat->nblk > 1 && omp_get_max_threads() > 1 && !omp_in_parallel()
+        && levmat->nB >= ITS_OMP_MIN_ROWS;
+}
 
-        for (k = 1; k < mata->nzcount[i]; k++)
-            x[i] -= kr[k] * x[ki[k]];
+/* x = U \ (L \ b), t = L \ b */
+static void lusol_blk(ITS_Per4Mat *levmat, double *b, double *t, double *x)
+{
+    int d, i;
+
+#pragma omp parallel for private(i) schedule(dynamic, 1)
+    for (d = 0; d < levmat->nblk; d++) {
+        for (i = levmat->blk[d]; i < levmat->blk[d + 1]; i++)
+            lsol_row(levmat->L, b, t, i);
+        for (i = levmat->blk[d + 1] - 1; i >= levmat->blk[d]; i--)
+            usol_row(levmat->U, NULL, t, x, i);
+    }
+}
 
-        x[i] *= kr[0];
+/* w = U \ (x - L \ w), in place */
+static void lusub_blk(ITS_Per4Mat *levmat, double *x, double *w)
+{
+    int d, i;
+
+#pragma omp parallel for private(i) schedule(dynamic, 1)
+    for (d = 0; d < levmat->nblk; d++) {
+        for (i = levmat->blk[d]; i < levmat->blk[d + 1]; i++)
+            lsol_row(levmat->L, w, w, i);
+        for (i = levmat->blk[d]; i < levmat->blk[d + 1]; i++)
+            w[i] = x[i] - w[i];
+        for (i = levmat->blk[d + 1] - 1; i >= levmat->blk[d]; i--)
+            usol_row(levmat->U, NULL, w, w, i);
     }
 }
+#endif
 
 /*---------------------------------------------------------------------
   | This function does the (block) forward elimination in ARMS
@@ -418,23 +679,39 @@ void itsol_Usol(ITS_SparMat *mata, double *b, double *x)
   |     |            |  |     |    |    |
   | x used and not touched -- or can be the same as wk.
   |--------------------------------------------------------------------*/
-int itsol_descend(ITS_Per4Mat *levmat, double *x, double *wk)
+static int descend_(ITS_Per4Mat *levmat, double *x, double *wk, double *work)
 {
     /*  local variables   */
     int j, len = levmat->n, lenB = levmat->nB, *iperm = levmat->rperm;
-    double *work = levmat->wk;
 
+#ifdef ITSOL_USE_OPENMP
+    int par = omp_get_max_threads() > 1 && !omp_in_parallel() && len >= ITS_OMP_MIN_ROWS;
+
+#pragma omp parallel for schedule(static) if (par)
+#endif
     for (j = 0; j < len; j++)
         work[iperm[j]] = x[j];
 
-    itsol_Lsol(levmat->L, work, wk);  /* sol:   L x = x                 */
-    itsol_Usol(levmat->U, wk, work);  /* sol:   U work(2) = work         */
+#ifdef ITSOL_USE_OPENMP
+    if (blk_par(levmat))
+        lusol_blk(levmat, work, wk, work);
+    else
+#endif
+    {
+        itsol_Lsol(levmat->L, work, wk);  /* sol:   L x = x                 */
+        itsol_Usol(levmat->U, wk, work);  /* sol:   U work(2) = work         */
+    }
 
     /*-------------------- compute x[lenb:.] = x [lenb:.] - E * work(1) */
     itsol_matvecz(levmat->E, work, &work[lenB], &wk[lenB]);
     return 0;
 }
 
+int itsol_descend(ITS_Per4Mat *levmat, double *x, double *wk)
+{
+    return descend_(levmat, x, wk, levmat->wk);
+}
+
 /*---------------------------------------------------------------------
   | This function does the (block) backward substitution: 
   |
@@ -446,29 +723,48 @@ int itsol_descend(ITS_Per4Mat *levmat, double *x, double *wk)
   |
   |    with x2 = S^{-1} wk2 [assumed to have been computed ] 
   |--------------------------------------------------------------------*/
-int itsol_ascend(ITS_Per4Mat *levmat, double *x, double *wk)
+static int ascend_(ITS_Per4Mat *levmat, double *x, double *wk, double *work)
 {
     int j, len = levmat->n, lenB = levmat->nB, *qperm = levmat->perm;
-    double *work = levmat->wk;
+
+#ifdef ITSOL_USE_OPENMP
+    int par = omp_get_max_threads() > 1 && !omp_in_parallel() && len >= ITS_OMP_MIN_ROWS;
+#endif
 
     itsol_matvec(levmat->F, &x[lenB], work);  /*  work = F * x_2   */
-    itsol_Lsol(levmat->L, work, work);        /*  work = L \ work    */
 
-    for (j = 0; j < lenB; j++)  /*  wk1 = wk1 - work  */
-        work[j] = x[j] - work[j];
+#ifdef ITSOL_USE_OPENMP
+    if (blk_par(levmat))
+        lusub_blk(levmat, x, work);
+    else
+#endif
+    {
+        itsol_Lsol(levmat->L, work, work);        /*  work = L \ work    */
+
+        for (j = 0; j < lenB; j++)  /*  wk1 = wk1 - work  */
+            work[j] = x[j] - work[j];
 
-    itsol_Usol(levmat->U, work, work);        /*  wk1 = U \ wk1 */
+        itsol_Usol(levmat->U, work, work);        /*  wk1 = U \ wk1 */
+    }
     memcpy(&work[lenB], &x[lenB], (len - lenB) * sizeof(double));
 
     /*---------------------------------------
       |   apply reverse permutation
       |--------------------------------------*/
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for schedule(static) if (par)
+#endif
     for (j = 0; j < len; j++)
         wk[j] = work[qperm[j]];
 
     return 0;
 }
 
+int itsol_ascend(ITS_Per4Mat *levmat, double *x, double *wk)
+{
+    return ascend_(levmat, x, wk, levmat->wk);
+}
+
 /*---------------------------------------------------------------------
   | This function does the matrix vector  z = y - A x.
   |----------------------------------------------------------------------
@@ -483,21 +779,50 @@ int itsol_ascend(ITS_Per4Mat *levmat, double *x, double *wk)
   |--------------------------------------------------------------------*/
 void itsol_matvecz(ITS_SparMat *mata, double *x, double *y, double *z)
 {
-    int i, k, *ki;
-    double *kr, t;
+    amxpbyz_(-1., mata, x, 1., y, z, 1);
+}
 
-    for (i = 0; i < mata->n; i++) {
-        kr = mata->ma[i];
-        ki = mata->ja[i];
-        t = y[i];
+/*---------------------------------------------------------------------
+  | sparse matrix - multiple vector product Y = A X for p vectors stored
+  | interleaved (entry i of vector j at x[i * p + j]). Every entry of A
+  | is loaded once for the p vectors.
+  |--------------------------------------------------------------------*/
+static inline void matvec_mv_row(ITS_SparMat *A, int p, double *x, double *y, int i)
+{
+    int j, k, *ki = A->ja[i];
+    double a, *kr = A->ma[i], *xk, *yi = y + (size_t)i * p;
 
-        for (k = 0; k < mata->nzcount[i]; k++)
-            t -= kr[k] * x[ki[k]];
+    for (j = 0; j < p; j++)
+        yi[j] = 0.0;
 
-        z[i] = t;
+    for (k = 0; k < A->nzcount[i]; k++) {
+        a = kr[k];
+        xk = x + (size_t)ki[k] * p;
+        for (j = 0; j < p; j++)
+            yi[j] += a * xk[j];
     }
 }
 
+void itsol_matvec_mv(ITS_SparMat *mata, int p, double *x, double *y)
+{
+    int i, n = mata->n;
+
+#ifdef ITSOL_USE_OPENMP
+    int par = omp_get_max_threads() > 1 && !omp_in_parallel() && n >= ITS_OMP_MIN_ROWS;
+
+#pragma omp parallel for schedule(dynamic, ITS_OMP_ROW_CHUNK) if (par)
+#endif
+    for (i = 0; i < n; i++)
+        matvec_mv_row(mata, p, x, y, i);
+}
+
+/* the ARMS solves below take an optional scratch vector work of the
+   length of the whole system. With work == NULL each level uses its own
+   wk buffer; a caller-owned work lets several threads apply the same
+   ARMS factors at the same time. */
+static void SchLsol_(ITS_ILUTSpar *ilusch, double *y, double *work);
+static void SchUsol_(ITS_ILUTSpar *ilusch, double *y, double *work);
+
 /* Macro L-solve -- corresponds to left (L) part of arms
    |  preconditioning operation -- 
    |  on entry : 
@@ -507,14 +832,15 @@ void itsol_matvecz(ITS_SparMat *mata, double *x, double *y, double *z)
    |  
    |  Note : in-place operation -- b and x can occupy the same space..
    | --------------------------------------------------------------------*/
-ITS_Per4Mat *itsol_Lvsol2(double *x, int nlev, ITS_Per4Mat *levmat, ITS_ILUTSpar *ilusch)
+static ITS_Per4Mat *Lvsol2_(double *x, int nlev, ITS_Per4Mat *levmat, ITS_ILUTSpar *ilusch,
+        double *work)
 {
     int nloc = levmat->n, first, lenB;
     ITS_Per4Mat *last = levmat;
 
     /*-------------------- take care of  special cases :  nlev==0 --> lusol  */
     if (nlev == 0) {
-        itsol_SchLsol(ilusch, x);
+        SchLsol_(ilusch, x, work ? work : ilusch->wk);
         return (last);
     }
 
@@ -527,18 +853,23 @@ ITS_Per4Mat *itsol_Lvsol2(double *x, int nlev, ITS_Per4Mat *levmat, ITS_ILUTSpar
         if (levmat->D1 != NULL)
             itsol_dscale(nloc, levmat->D1, &x[first], &x[first]);
         /*--------------------  RESTRICTION/ DESCENT OPERATION  */
-        if (lenB) itsol_descend(levmat, &x[first], &x[first]);
+        if (lenB) descend_(levmat, &x[first], &x[first], work ? work : levmat->wk);
 
         first += lenB;
         last = levmat;
         levmat = levmat->next;
     }
 
-    itsol_SchLsol(ilusch, &x[first]);
+    SchLsol_(ilusch, &x[first], work ? work : ilusch->wk);
 
     return last;
 }
 
+ITS_Per4Mat *itsol_Lvsol2(double *x, int nlev, ITS_Per4Mat *levmat, ITS_ILUTSpar *ilusch)
+{
+    return Lvsol2_(x, nlev, levmat, ilusch, NULL);
+}
+
 /* Macro U-solve -- corresponds to right (U) part of arms
    |  preconditioning operation -- 
    |  on entry : 
@@ -548,11 +879,12 @@ ITS_Per4Mat *itsol_Lvsol2(double *x, int nlev, ITS_Per4Mat *levmat, ITS_ILUTSpar
    |  
    |  Note : in-place operation -- b and x  can occupy the same space..
    | --------------------------------------------------------------------*/
-int itsol_Uvsol2(double *x, int nlev, int n, ITS_Per4Mat *levmat, ITS_ILUTSpar *ilusch)
+static int Uvsol2_(double *x, int nlev, int n, ITS_Per4Mat *levmat, ITS_ILUTSpar *ilusch,
+        double *work)
 {
     int nloc, lenB, first;
     if (nlev == 0) {
-        itsol_SchUsol(ilusch, x);
+        SchUsol_(ilusch, x, work ? work : ilusch->wk);
         return (0);
     }
 
@@ -562,12 +894,12 @@ int itsol_Uvsol2(double *x, int nlev, int n, ITS_Per4Mat *levmat, ITS_ILUTSpar *
     first = n - nloc;
     /*-------------------- last level                                 */
     first += lenB;
-    itsol_SchUsol(ilusch, &x[first]);
+    SchUsol_(ilusch, &x[first], work ? work : ilusch->wk);
     /*-------------------- other levels                               */
     while (levmat) {
         nloc = levmat->n;
         first -= levmat->nB;
-        if (levmat->n) itsol_ascend(levmat, &x[first], &x[first]);
+        if (levmat->n) ascend_(levmat, &x[first], &x[first], work ? work : levmat->wk);
 
         /*-------------------- right scaling */
         if (levmat->D2 != NULL) itsol_dscale(nloc, levmat->D2, &x[first], &x[first]);
@@ -577,6 +909,11 @@ int itsol_Uvsol2(double *x, int nlev, int n, ITS_Per4Mat *levmat, ITS_ILUTSpar *
     return 0;
 }
 
+int itsol_Uvsol2(double *x, int nlev, int n, ITS_Per4Mat *levmat, ITS_ILUTSpar *ilusch)
+{
+    return Uvsol2_(x, nlev, n, levmat, ilusch, NULL);
+}
+
 /* combined preconditioning operation -- combines the
    |  left and right actions. 
    | 
@@ -588,6 +925,16 @@ int itsol_Uvsol2(double *x, int nlev, int n, ITS_Per4Mat *levmat, ITS_ILUTSpar *
    |  Note : in-place operation -- b and x can occupy the same space..
    | --------------------------------------------------------------------*/
 int itsol_armsol2(double *x, ITS_ARMSpar *Prec)
+{
+    return itsol_armsol2_r(x, Prec, NULL);
+}
+
+/*---------------------------------------------------------------------
+  | same as itsol_armsol2 with a scratch vector work of length Prec->n
+  | (NULL: the wk buffers of the levels). The factors are only read,
+  | so concurrent calls with different work are safe.
+  |--------------------------------------------------------------------*/
+int itsol_armsol2_r(double *x, ITS_ARMSpar *Prec, double *work)
 {
     ITS_Per4Mat *levmat = Prec->levmat;
     ITS_ILUTSpar *ilusch = Prec->ilus;
@@ -597,13 +944,13 @@ int itsol_armsol2(double *x, ITS_ARMSpar *Prec)
 
     if (nlev == 0) {
         n = ilusch->n;
-        itsol_SchLsol(ilusch, x);
-        itsol_SchUsol(ilusch, x);
+        SchLsol_(ilusch, x, work ? work : ilusch->wk);
+        SchUsol_(ilusch, x, work ? work : ilusch->wk);
         return 0;
     }
 
-    last = itsol_Lvsol2(x, nlev, levmat, ilusch);
-    itsol_Uvsol2(x, nlev, n, last, ilusch);
+    last = Lvsol2_(x, nlev, levmat, ilusch, work);
+    Uvsol2_(x, nlev, n, last, ilusch, work);
 
     return 0;
 }
@@ -619,9 +966,13 @@ int itsol_armsol2(double *x, ITS_ARMSpar *Prec)
   | y       = solution of LU x = y. [overwritten] 
   |---------------------------------------------------------------------*/
 void itsol_SchLsol(ITS_ILUTSpar *ilusch, double *y)
+{
+    SchLsol_(ilusch, y, ilusch->wk);
+}
+
+static void SchLsol_(ITS_ILUTSpar *ilusch, double *y, double *work)
 {
     int n = ilusch->n, j, *perm = ilusch->rperm;
-    double *work = ilusch->wk;
 
     /*-------------------- begin: right scaling                          */
     if (ilusch->D1 != NULL)
@@ -648,9 +999,13 @@ void itsol_SchLsol(ITS_ILUTSpar *ilusch, double *y)
   | y       = solution of U x = y. [overwritten on y] 
   |----------------------------------------------------------------------*/
 void itsol_SchUsol(ITS_ILUTSpar *ilusch, double *y)
+{
+    SchUsol_(ilusch, y, ilusch->wk);
+}
+
+static void SchUsol_(ITS_ILUTSpar *ilusch, double *y, double *work)
 {
     int n = ilusch->n, j, *perm = ilusch->perm, *cperm;
-    double *work = ilusch->wk;
     /* -------------------- begin by U-solving */
     /*-------------------- CASE: column pivoting  used (as in ILUTP) */
     if (ilusch->perm2 != NULL) {
@@ -720,32 +1075,190 @@ void itsol_luinv(int n, double *a, double *x, double *y)
  *--------------------------------------------------------------------*/
 int itsol_lusolC(double *y, double *x, ITS_ILUSpar *lu)
 {
-    int n = lu->n, i, j, nzcount, *ja;
+    int n = lu->n, i;
     double *D;
     ITS_SparMat *L, *U;
 
+    if (lu->nsweep > 0) return itsol_lusolC_r(y, x, lu, lu->swk);
+
     L = lu->L;
     U = lu->U;
     D = lu->D;
 
     /* Block L solve */
-    for (i = 0; i < n; i++) {
-        x[i] = y[i];
-        nzcount = L->nzcount[i];
-        ja = L->ja[i];
-        for (j = 0; j < nzcount; j++) {
-            x[i] -= x[ja[j]] * L->ma[i][j];
+#ifdef ITSOL_USE_OPENMP
+    if (lev_par(L))
+        lsol_lev(L, y, x);
+    else
+#endif
+    for (i = 0; i < n; i++)
+        lsol_row(L, y, x, i);
+
+    /* Block -- U solve */
+#ifdef ITSOL_USE_OPENMP
+    if (lev_par(U))
+        usol_lev(U, D, x, x);
+    else
+#endif
+    for (i = n - 1; i >= 0; i--)
+        usol_row(U, D, x, x, i);
+
+    return (0);
+}
+
+/*---------------------------------------------------------------------
+  | Jacobi sweeps on a triangular factor T with a strict triangle:
+  |     x = D b,  then nsw times  x = D (b - T x)
+  | (D == NULL: unit diagonal). Every sweep is a matvec with T, the rows
+  | are independent. nsw = number of rows - 1 gives the exact solve.
+  | w is a scratch vector of length n; b and x must differ.
+  |--------------------------------------------------------------------*/
+static void jac_sweeps_(ITS_SparMat *T, double *D, double *b, double *x, int nsw, double *w)
+{
+    int i, k, s, n = T->n, *ki;
+    double t, *xo, *xn, *xt;
+
+#ifdef ITSOL_USE_OPENMP
+    int par = omp_get_max_threads() > 1 && !omp_in_parallel() && n >= ITS_OMP_MIN_ROWS;
+#endif
+
+    /* the iterates alternate between x and w, the last one lands in x */
+    xo = (nsw % 2) ? w : x;
+    xn = (nsw % 2) ? x : w;
+
+    for (i = 0; i < n; i++)
+        xo[i] = D == NULL ? b[i] : D[i] * b[i];
+
+    for (s = 0; s < nsw; s++) {
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for private(k, ki, t) schedule(dynamic, ITS_OMP_ROW_CHUNK) if (par)
+#endif
+        for (i = 0; i < n; i++) {
+            ki = T->ja[i];
+            t = b[i];
+
+            if (T->fa) {
+                float *fr = T->fa[i];
+
+                for (k = 0; k < T->nzcount[i]; k++)
+                    t -= fr[k] * xo[ki[k]];
+            }
+            else {
+                double *kr = T->ma[i];
+
+                for (k = 0; k < T->nzcount[i]; k++)
+                    t -= kr[k] * xo[ki[k]];
+            }
+            xn[i] = D == NULL ? t : D[i] * t;
         }
+
+        xt = xo;
+        xo = xn;
+        xn = xt;
     }
-    /* Block -- U solve */
-    for (i = n - 1; i >= 0; i--) {
-        nzcount = U->nzcount[i];
-        ja = U->ja[i];
-        for (j = 0; j < nzcount; j++) {
-            x[i] -= x[ja[j]] * U->ma[i][j];
+}
+
+/*----------------------------------------------------------------------
+ *    itsol_lusolC with the scratch in work. With lu->nsweep > 0 the
+ *    forward and backward solves are replaced by lu->nsweep Jacobi
+ *    sweeps each (an approximate apply that runs in parallel), work
+ *    then holds 2 * n doubles. y and x can be the same.
+ *--------------------------------------------------------------------*/
+int itsol_lusolC_r(double *y, double *x, ITS_ILUSpar *lu, double *work)
+{
+    int n = lu->n;
+    double *b = work + n;
+
+    if (lu->nsweep <= 0) return itsol_lusolC(y, x, lu);
+
+    if (y == x) {
+        memcpy(b, y, n * sizeof(double));
+        y = b;
+    }
+    jac_sweeps_(lu->L, NULL, y, x, lu->nsweep, work);
+
+    memcpy(b, x, n * sizeof(double));
+    jac_sweeps_(lu->U, lu->D, b, x, lu->nsweep, work);
+
+    return (0);
+}
+
+/*----------------------------------------------------------------------
+ *    itsol_lusolC for p right-hand-sides stored interleaved
+ *    (entry i of vector j at y[i * p + j]): each row of the factors
+ *    is loaded once for the p vectors. y and x can be the same.
+ *--------------------------------------------------------------------*/
+static inline void lsol_row_mv(ITS_SparMat *L, int p, double *b, double *x, int i)
+{
+    int j, k, *ki = L->ja[i];
+    double a, *kr = L->ma ? L->ma[i] : NULL, *xk, *xi = x + (size_t)i * p, *bi = b + (size_t)i * p;
+    float *fr = L->fa ? L->fa[i] : NULL;
+
+    for (j = 0; j < p; j++)
+        xi[j] = bi[j];
+
+    for (k = 0; k < L->nzcount[i]; k++) {
+        a = fr ? fr[k] : kr[k];
+        xk = x + (size_t)ki[k] * p;
+        for (j = 0; j < p; j++)
+            xi[j] -= a * xk[j];
+    }
+}
+
+static inline void usol_row_mv(ITS_SparMat *U, double *D, int p, double *x, int i)
+{
+    int j, k, *ki = U->ja[i];
+    double a, *kr = U->ma ? U->ma[i] : NULL, *xk, *xi = x + (size_t)i * p;
+    float *fr = U->fa ? U->fa[i] : NULL;
+
+    for (k = 0; k < U->nzcount[i]; k++) {
+        a = fr ? fr[k] : kr[k];
+        xk = x + (size_t)ki[k] * p;
+        for (j = 0; j < p; j++)
+            xi[j] -= a * xk[j];
+    }
+    for (j = 0; j < p; j++)
+        xi[j] *= D[i];
+}
+
+int itsol_lusolC_mv(int p, double *y, double *x, ITS_ILUSpar *lu)
+{
+    int n = lu->n, i;
+    ITS_SparMat *L = lu->L, *U = lu->U;
+
+#ifdef ITSOL_USE_OPENMP
+    ITS_LevSched *sc;
+    int l, k;
+
+    if (lev_par(L)) {
+        sc = L->sched;
+#pragma omp parallel private(l, k)
+        for (l = 0; l < sc->nlev; l++) {
+#pragma omp for schedule(static)
+            for (k = sc->lev[l]; k < sc->lev[l + 1]; k++)
+                lsol_row_mv(L, p, y, x, sc->rows[k]);
+        }
+    }
+    else
+#endif
+    for (i = 0; i < n; i++)
+        lsol_row_mv(L, p, y, x, i);
+
+#ifdef ITSOL_USE_OPENMP
+    if (lev_par(U)) {
+        sc = U->sched;
+#pragma omp parallel private(l, k)
+        for (l = 0; l < sc->nlev; l++) {
+#pragma omp for schedule(static)
+            for (k = sc->lev[l]; k < sc->lev[l + 1]; k++)
+                usol_row_mv(U, lu->D, p, x, sc->rows[k]);
         }
-        x[i] *= D[i];
     }
+    else
+#endif
+    for (i = n - 1; i >= 0; i--)
+        usol_row_mv(U, lu->D, p, x, i);
+
     return (0);
 }
 
@@ -788,6 +1301,20 @@ int itsol_lumsolC(double *y, double *x, ITS_ILUSpar *lu)
     return 0;
 }
 
+/* y = y - A x, A a dim x sz column-major block in single precision */
+static void fgemv_(int dim, int sz, float *a, double *x, double *y)
+{
+    int i, j;
+    double xj;
+
+    for (j = 0; j < sz; j++) {
+        xj = x[j];
+        for (i = 0; i < dim; i++)
+            y[i] -= a[i] * xj;
+        a += dim;
+    }
+}
+
 /*----------------------------------------------------------------------
  *    performs a forward followed by a backward block solve
  *    for LU matrix as produced by VBILUT
@@ -798,6 +1325,16 @@ int itsol_lumsolC(double *y, double *x, ITS_ILUSpar *lu)
  *    note: lu->bf is used to store vector
  *--------------------------------------------------------------------*/
 int itsol_vblusolC(double *y, double *x, ITS_VBILUSpar *lu)
+{
+    return itsol_vblusolC_r(y, x, lu, lu->bf);
+}
+
+/*----------------------------------------------------------------------
+ *    same as itsol_vblusolC with bf, a vector of the size of the
+ *    largest block, used instead of lu->bf. The factors are only read,
+ *    so concurrent calls with different bf are safe.
+ *--------------------------------------------------------------------*/
+int itsol_vblusolC_r(double *y, double *x, ITS_VBILUSpar *lu, double *bf)
 {
     int n = lu->n, *bsz = lu->bsz, i, j, bi, icol, dim, sz;
     int nzcount, nBs, nID, *ja, inc = 1, OPT;
@@ -820,12 +1357,24 @@ int itsol_vblusolC(double *y, double *x, ITS_VBILUSpar *lu)
 
         nzcount = L->nzcount[i];
         ja = L->ja[i];
-        ba = L->ba[i];
-        for (j = 0; j < nzcount; j++) {
-            icol = ja[j];
-            sz = ITS_B_DIM(bsz, icol);
-            data = ba[j];
-            itsol_dgemv("n", dim, sz, alpha, data, dim, x + bsz[icol], inc, beta, x + nBs, inc);
+        if (L->fa) {
+            float *fb = L->fa[i];
+
+            for (j = 0; j < nzcount; j++) {
+                icol = ja[j];
+                sz = ITS_B_DIM(bsz, icol);
+                fgemv_(dim, sz, fb, x + bsz[icol], x + nBs);
+                fb += dim * sz;
+            }
+        }
+        else {
+            ba = L->ba[i];
+            for (j = 0; j < nzcount; j++) {
+                icol = ja[j];
+                sz = ITS_B_DIM(bsz, icol);
+                data = ba[j];
+                itsol_dgemv("n", dim, sz, alpha, data, dim, x + bsz[icol], inc, beta, x + nBs, inc);
+            }
         }
     }
     /* Block -- U solve */
@@ -834,21 +1383,33 @@ int itsol_vblusolC(double *y, double *x, ITS_VBILUSpar *lu)
         nzcount = U->nzcount[i];
         nBs = bsz[i];
         ja = U->ja[i];
-        ba = U->ba[i];
-        for (j = 0; j < nzcount; j++) {
-            icol = ja[j];
-            sz = ITS_B_DIM(bsz, icol);
-            data = ba[j];
-            itsol_dgemv("n", dim, sz, alpha, data, dim, x + bsz[icol], inc, beta, x + nBs, inc);
+        if (U->fa) {
+            float *fb = U->fa[i];
+
+            for (j = 0; j < nzcount; j++) {
+                icol = ja[j];
+                sz = ITS_B_DIM(bsz, icol);
+                fgemv_(dim, sz, fb, x + bsz[icol], x + nBs);
+                fb += dim * sz;
+            }
+        }
+        else {
+            ba = U->ba[i];
+            for (j = 0; j < nzcount; j++) {
+                icol = ja[j];
+                sz = ITS_B_DIM(bsz, icol);
+                data = ba[j];
+                itsol_dgemv("n", dim, sz, alpha, data, dim, x + bsz[icol], inc, beta, x + nBs, inc);
+            }
         }
         data = D[i];
         if (OPT == 1)
-            itsol_luinv(dim, data, x + nBs, lu->bf);
+            itsol_luinv(dim, data, x + nBs, bf);
         else
-            itsol_dgemv("n", dim, dim, alpha2, data, dim, x + nBs, inc, beta2, lu->bf, inc);
+            itsol_dgemv("n", dim, dim, alpha2, data, dim, x + nBs, inc, beta2, bf, inc);
 
         for (bi = 0; bi < dim; bi++) {
-            x[nBs + bi] = lu->bf[bi];
+            x[nBs + bi] = bf[bi];
         }
     }
 
@@ -896,6 +1457,9 @@ int itsol_rpermC(ITS_SparMat *mat, int *perm)
     free(addj);
     free(addm);
     free(nnz);
+
+    /*-------------------- flat storage: put the rows back in order */
+    if (mat->ia) itsol_csflat(mat, 2);
     return 0;
 }
 
@@ -923,19 +1487,21 @@ int itsol_rpermC(ITS_SparMat *mat, int *perm)
   |---------------------------------------------------------------------*/
 int itsol_cpermC(ITS_SparMat *mat, int *perm)
 {
-    int i, j, *newj, size = mat->n, *aja;
+    int i, j, size = mat->n, *aja;
 
-    newj = (int *)itsol_malloc(size * sizeof(int), "cpermC");
+#ifdef ITSOL_USE_OPENMP
+    int par = omp_get_max_threads() > 1 && !omp_in_parallel() && size >= ITS_OMP_MIN_ROWS;
+#endif
+
+    /*-------------------- rows are relabeled in place, independently */
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for private(j, aja) schedule(dynamic, ITS_OMP_ROW_CHUNK) if (par)
+#endif
     for (i = 0; i < size; i++) {
         aja = mat->ja[i];
         for (j = 0; j < mat->nzcount[i]; j++)
-            newj[j] = perm[aja[j]];
-
-        for (j = 0; j < mat->nzcount[i]; j++)
-            aja[j] = newj[j];
-        mat->ja[i] = aja;
+            aja[j] = perm[aja[j]];
     }
-    free(newj);
     return 0;
 }
 
@@ -1136,6 +1702,11 @@ void itsol_matvecCSR(ITS_SMat *mat, double *x, double *y)
     itsol_matvec(mat->CS, x, y);
 }
 
+void itsol_matvecCSR_mv(ITS_SMat *mat, int p, double *x, double *y)
+{
+    itsol_matvec_mv(mat->CS, p, x, y);
+}
+
 void itsol_matvecCSC(ITS_SMat *mat, double *x, double *y)
 {
     itsol_matvecC(mat->CS, x, y);
@@ -1146,15 +1717,134 @@ void itsol_matvecVBR(ITS_SMat *mat, double *x, double *y)
     itsol_vbmatvec(mat->VBCSR, x, y);
 }
 
+/*---------------------------------------------------------------------
+  | y = A x for the slices s0 <= s < s1 of a SELL-C-sigma matrix.
+  | One slice is one vector of ITS_SELL_C (= 8) rows: a single AVX-512
+  | register or two AVX2 registers, with x gathered through ja.
+  |--------------------------------------------------------------------*/
+static void sell_slices(ITS_SellMat *A, double *x, double *y, int s0, int s1)
+{
+    int s, k, r, *ja = A->ja, *rows;
+    ITS_INT off;
+    double *ma = A->ma, t[ITS_SELL_C];
+
+    for (s = s0; s < s1; s++) {
+        off = A->sptr[s];
+        rows = &A->rows[s * ITS_SELL_C];
+#if defined(__AVX512F__)
+        {
+            __m512d acc = _mm512_setzero_pd();
+
+            for (k = 0; k < A->slen[s]; k++, off += ITS_SELL_C) {
+                __m256i idx = _mm256_loadu_si256((__m256i *)&ja[off]);
+                acc = _mm512_fmadd_pd(_mm512_loadu_pd(&ma[off]), _mm512_i32gather_pd(idx, x, 8), acc);
+            }
+            _mm512_storeu_pd(t, acc);
+        }
+#elif defined(__AVX2__)
+        {
+            __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+
+            for (k = 0; k < A->slen[s]; k++, off += ITS_SELL_C) {
+                __m256d x0 = _mm256_i32gather_pd(x, _mm_loadu_si128((__m128i *)&ja[off]), 8);
+                __m256d x1 = _mm256_i32gather_pd(x, _mm_loadu_si128((__m128i *)&ja[off + 4]), 8);
+#if defined(__FMA__)
+                acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(&ma[off]), x0, acc0);
+                acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(&ma[off + 4]), x1, acc1);
+#else
+                acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(&ma[off]), x0));
+                acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(&ma[off + 4]), x1));
+#endif
+            }
+            _mm256_storeu_pd(t, acc0);
+            _mm256_storeu_pd(&t[4], acc1);
+        }
+#else
+        for (r = 0; r < ITS_SELL_C; r++)
+            t[r] = 0.0;
+        for (k = 0; k < A->slen[s]; k++, off += ITS_SELL_C)
+            for (r = 0; r < ITS_SELL_C; r++)
+                t[r] += ma[off + r] * x[ja[off + r]];
+#endif
+        for (r = 0; r < ITS_SELL_C; r++)
+            if (rows[r] >= 0) y[rows[r]] = t[r];
+    }
+}
+
+/*---------------------------------------------------------------------
+  | matvec for ITS_SMat holding a SELL-C-sigma matrix (Mtype 4).
+  | Threads get slices with (about) the same number of stored entries.
+  |--------------------------------------------------------------------*/
+void itsol_matvecSELL(ITS_SMat *mat, double *x, double *y)
+{
+    ITS_SellMat *A = mat->SELL;
+
+#ifdef ITSOL_USE_OPENMP
+    if (omp_get_max_threads() > 1 && !omp_in_parallel() && A->sptr[A->nslices] >= ITS_OMP_MIN_NNZ) {
+#pragma omp parallel
+        {
+            int nt = omp_get_num_threads(), t = omp_get_thread_num();
+
+            sell_slices(A, x, y, nnz_split(A->sptr, A->nslices, t, nt), nnz_split(A->sptr, A->nslices, t + 1, nt));
+        }
+        return;
+    }
+#endif
+    sell_slices(A, x, y, 0, A->nslices);
+}
+
+/*---------------------------------------------------------------------
+  | part t out of nt of y = A x for the matrices of itsol_matvecCSR and
+  | itsol_matvecSELL, split as these split them between threads. Opens
+  | no parallel region: each thread of a region calls it with its own
+  | t to share the product with other work of the region. Returns 1,
+  | with nothing done, for the other matvecs.
+  |--------------------------------------------------------------------*/
+int itsol_matvec_part(ITS_SMat *mat, double *x, double *y, int t, int nt)
+{
+    if (mat->matvec == itsol_matvecCSR) {
+        ITS_SparMat *A = mat->CS;
+        int n = A->n;
+
+        if (A->ia)
+            amxpbyz_rows(1., A, x, 0., NULL, y, 0, nnz_split(A->ia, n, t, nt),
+                    nnz_split(A->ia, n, t + 1, nt));
+        else
+            amxpbyz_rows(1., A, x, 0., NULL, y, 0, (int)((long)n * t / nt),
+                    (int)((long)n * (t + 1) / nt));
+        return 0;
+    }
+
+    if (mat->matvec == itsol_matvecSELL) {
+        ITS_SellMat *A = mat->SELL;
+
+        sell_slices(A, x, y, nnz_split(A->sptr, A->nslices, t, nt),
+                nnz_split(A->sptr, A->nslices, t + 1, nt));
+        return 0;
+    }
+
+    return 1;
+}
+
 int itsol_preconILU(double *x, double *y, ITS_PC *mat)
 {
     /*-------------------- precon for csr format using the ITS_PC struct*/
+    if (mat->wk != NULL)
+        return itsol_lusolC_r(x, y, mat->ILU, mat->wk);
     return itsol_lusolC(x, y, mat->ILU);
 }
 
+int itsol_preconILU_mv(int p, double *x, double *y, ITS_PC *mat)
+{
+    /*-------------------- same for p interleaved vectors */
+    return itsol_lusolC_mv(p, x, y, mat->ILU);
+}
+
 int itsol_preconVBR(double *x, double *y, ITS_PC *mat)
 {
     /*-------------------- precon for ldu format using the ITS_PC struct*/
+    if (mat->wk != NULL)
+        return itsol_vblusolC_r(x, y, mat->VBILU, mat->wk);
     return itsol_vblusolC(x, y, mat->VBILU);
 }
 
@@ -1169,7 +1859,49 @@ int itsol_preconARMS(double *x, double *y, ITS_PC *mat)
     /*-------------------- precon for ldu format using the ITS_PC struct*/
     int n = (mat->ARMS)->n;
     memcpy(y, x, n * sizeof(double));
-    return itsol_armsol2(y, mat->ARMS);
+    return itsol_armsol2_r(y, mat->ARMS, mat->wk);
+}
+
+/*----------------------------------------------------------------------
+  | y = A x and y = M^{-1} x as done by the iterative solvers: through
+  | Amat->matvec and lu->precon (a copy when lu == NULL), timed and
+  | counted in Amat->stats when it is set.
+  |--------------------------------------------------------------------*/
+void itsol_matvec_st(ITS_SMat *Amat, double *x, double *y)
+{
+    ITS_STATS *st = Amat->stats;
+    double t;
+
+    if (st == NULL) {
+        Amat->matvec(Amat, x, y);
+        return;
+    }
+
+    t = itsol_get_time();
+    Amat->matvec(Amat, x, y);
+    st->t_matvec += itsol_get_time() - t;
+    st->nmatvec++;
+}
+
+int itsol_precon_st(ITS_SMat *Amat, ITS_PC *lu, double *x, double *y)
+{
+    ITS_STATS *st = Amat->stats;
+    double t = 0;
+    int ierr = 0;
+
+    if (st != NULL) t = itsol_get_time();
+
+    if (lu == NULL)
+        memcpy(y, x, Amat->n * sizeof(double));
+    else
+        ierr = lu->precon(x, y, lu);
+
+    if (st != NULL) {
+        st->t_precon += itsol_get_time() - t;
+        st->nprecon++;
+    }
+
+    return ierr;
 }
 
 typedef struct __KeyType {
@@ -0,0 +1,166 @@
+
+#include "matgen.h"
+
+/*----------------------------------------------------------------------
+  | assemble a 7-point stencil with dof x dof blocks
+  |----------------------------------------------------------------------
+  | w[0]     = centre coefficient
+  | w[1..6]  = coefficients of the -x, +x, -y, +y, -z, +z neighbours
+  | dof, cpl = unknowns per grid point, each coefficient c is the block
+  |            with c on the diagonal and cpl * c off it
+  |--------------------------------------------------------------------*/
+static int stencil_(int nx, int ny, int nz, double *w, int dof, double cpl, ITS_CooMat *A)
+{
+    /* columns in increasing order: -z, -y, -x, centre, +x, +y, +z */
+    static const int order[7] = {5, 3, 1, 0, 2, 4, 6};
+    int i, j, l, a, b, d, s, r, row, nb;
+    int off[7], ok[7];
+    ITS_INT k = 0;
+    double pts, len;
+
+    memset(A, 0, sizeof(*A));
+
+    if (nx < 1 || ny < 1 || nz < 1 || dof < 1) return 1;
+
+    /* entries: centre, two per direction less the boundary ones */
+    pts = (double)nx * ny * nz;
+    len = pts + 2 * (pts - pts / nx) + 2 * (pts - pts / ny) + 2 * (pts - pts / nz);
+    len *= (double)dof * dof;
+
+    if (pts * dof > INT_MAX || len > ITS_INT_MAX || len * sizeof(double) > SIZE_MAX) return 2;
+
+    A->n = nx * ny * nz * dof;
+    A->nnz = (ITS_INT)len;
+    A->ia = (int *)itsol_malloc(A->nnz * sizeof(int), "gen:ia");
+    A->ja = (int *)itsol_malloc(A->nnz * sizeof(int), "gen:ja");
+    A->ma = (double *)itsol_malloc(A->nnz * sizeof(double), "gen:ma");
+
+    off[0] = 0;
+    off[1] = -1;
+    off[2] = 1;
+    off[3] = -nx;
+    off[4] = nx;
+    off[5] = -nx * ny;
+    off[6] = nx * ny;
+
+    for (l = 0; l < nz; l++) {
+        for (j = 0; j < ny; j++) {
+            for (i = 0; i < nx; i++) {
+                r = (l * ny + j) * nx + i;
+
+                ok[0] = 1;
+                ok[1] = i > 0;
+                ok[2] = i < nx - 1;
+                ok[3] = j > 0;
+                ok[4] = j < ny - 1;
+                ok[5] = l > 0;
+                ok[6] = l < nz - 1;
+
+                for (a = 0; a < dof; a++) {
+                    row = r * dof + a;
+
+                    for (d = 0; d < 7; d++) {
+                        s = order[d];
+                        if (!ok[s]) continue;
+
+                        nb = (r + off[s]) * dof;
+                        for (b = 0; b < dof; b++) {
+                            A->ia[k] = row;
+                            A->ja[k] = nb + b;
+                            A->ma[k] = a == b ? w[s] : cpl * w[s];
+                            k++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+  | coefficients of -(kx u_xx + ky u_yy + kz u_zz) + c . grad(u) times h^2
+  |----------------------------------------------------------------------
+  | k[3] = diffusion, c[3] = convection per direction
+  | y and z are left out when they have a single grid point
+  |--------------------------------------------------------------------*/
+static void coefs_(int *nn, double h, double *k, double *c, int upwind, double *w)
+{
+    int d;
+    double ch;
+
+    memset(w, 0, 7 * sizeof(double));
+
+    for (d = 0; d < 3; d++) {
+        if (d > 0 && nn[d] == 1) continue;
+
+        ch = c[d] * h;
+        w[0] += 2 * k[d];
+
+        if (upwind) {
+            /* backward difference for c > 0, forward for c < 0 */
+            w[0] += fabs(ch);
+            w[1 + 2 * d] = -k[d] - (ch > 0 ? ch : 0);
+            w[2 + 2 * d] = -k[d] + (ch < 0 ? ch : 0);
+        }
+        else {
+            w[1 + 2 * d] = -k[d] - 0.5 * ch;
+            w[2 + 2 * d] = -k[d] + 0.5 * ch;
+        }
+    }
+}
+
+int itsol_gen_poisson(int nx, int ny, int nz, ITS_CooMat *A)
+{
+    return itsol_gen_aniso(nx, ny, nz, 1.0, 1.0, 1.0, A);
+}
+
+int itsol_gen_aniso(int nx, int ny, int nz, double kx, double ky, double kz, ITS_CooMat *A)
+{
+    int nn[3];
+    double k[3], c[3] = {0, 0, 0}, w[7];
+
+    nn[0] = nx;
+    nn[1] = ny;
+    nn[2] = nz;
+    k[0] = kx;
+    k[1] = ky;
+    k[2] = kz;
+
+    coefs_(nn, 1.0 / (nx + 1), k, c, 0, w);
+
+    return stencil_(nx, ny, nz, w, 1, 0.0, A);
+}
+
+int itsol_gen_convdiff(int nx, int ny, int nz, double pe, double bx, double by, double bz,
+        int upwind, ITS_CooMat *A)
+{
+    int nn[3];
+    double k[3] = {1, 1, 1}, c[3], w[7];
+
+    nn[0] = nx;
+    nn[1] = ny;
+    nn[2] = nz;
+    c[0] = pe * bx;
+    c[1] = pe * by;
+    c[2] = pe * bz;
+
+    coefs_(nn, 1.0 / (nx + 1), k, c, upwind, w);
+
+    return stencil_(nx, ny, nz, w, 1, 0.0, A);
+}
+
+int itsol_gen_block(int nx, int ny, int nz, int dof, double cpl, ITS_CooMat *A)
+{
+    int nn[3];
+    double k[3] = {1, 1, 1}, c[3] = {0, 0, 0}, w[7];
+
+    nn[0] = nx;
+    nn[1] = ny;
+    nn[2] = nz;
+
+    coefs_(nn, 1.0 / (nx + 1), k, c, 0, w);
+
+    return stencil_(nx, ny, nz, w, dof, cpl, A);
+}
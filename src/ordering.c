@@ -0,0 +1,585 @@
+
+#include "ordering.h"
+
+/*----------------------------------------------------------------------
+  | graph of A + A^T without the diagonal, each edge once:
+  | neighbors of i are adj[xadj[i] .. xadj[i+1]-1]
+  |--------------------------------------------------------------------*/
+static void sym_graph_(ITS_SparMat *mat, ITS_INT **pxadj, int **padj)
+{
+    int i, j, k, n = mat->n, *tind, *mark, *adj;
+    ITS_INT p, nnz = 0, *tptr, *xadj;
+
+    /* pattern of A^T */
+    tptr = (ITS_INT *)itsol_malloc((n + 1) * sizeof(ITS_INT), "sym_graph");
+    for (i = 0; i <= n; i++)
+        tptr[i] = 0;
+    for (i = 0; i < n; i++)
+        for (k = 0; k < mat->nzcount[i]; k++)
+            if (mat->ja[i][k] != i) {
+                tptr[mat->ja[i][k] + 1]++;
+                nnz++;
+            }
+    for (i = 0; i < n; i++)
+        tptr[i + 1] += tptr[i];
+
+    tind = (int *)itsol_malloc((nnz > 0 ? nnz : 1) * sizeof(int), "sym_graph");
+    for (i = 0; i < n; i++)
+        for (k = 0; k < mat->nzcount[i]; k++)
+            if ((j = mat->ja[i][k]) != i) tind[tptr[j]++] = i;
+    for (i = n; i > 0; i--)
+        tptr[i] = tptr[i - 1];
+    tptr[0] = 0;
+
+    /* union of row i of A and of A^T */
+    xadj = (ITS_INT *)itsol_malloc((n + 1) * sizeof(ITS_INT), "sym_graph");
+    adj = (int *)itsol_malloc((nnz > 0 ? 2 * nnz : 1) * sizeof(int), "sym_graph");
+    mark = (int *)itsol_malloc(n * sizeof(int), "sym_graph");
+    for (i = 0; i < n; i++)
+        mark[i] = -1;
+
+    p = 0;
+    for (i = 0; i < n; i++) {
+        xadj[i] = p;
+        mark[i] = i;
+        for (k = 0; k < mat->nzcount[i]; k++) {
+            j = mat->ja[i][k];
+            if (mark[j] == i) continue;
+            mark[j] = i;
+            adj[p++] = j;
+        }
+        for (; tptr[i] < tptr[i + 1]; tptr[i]++) {
+            j = tind[tptr[i]];
+            if (mark[j] == i) continue;
+            mark[j] = i;
+            adj[p++] = j;
+        }
+    }
+    xadj[n] = p;
+
+    free(tptr);
+    free(tind);
+    free(mark);
+
+    *pxadj = xadj;
+    *padj = adj;
+}
+
+/*----------------------------------------------------------------------
+  | greedy multicoloring: nodes in natural order, each gets the smallest
+  | color not taken by a neighbor. Within a color the natural order is
+  | kept.
+  |--------------------------------------------------------------------*/
+int itsol_mcolor(ITS_SparMat *mat, int *perm, int *ncolor)
+{
+    int i, c, n = mat->n, nc = 0, maxdeg = 0, *adj, *color, *mark, *cptr;
+    ITS_INT k, *xadj;
+
+    sym_graph_(mat, &xadj, &adj);
+
+    for (i = 0; i < n; i++)
+        maxdeg = its_max(maxdeg, (int)(xadj[i + 1] - xadj[i]));
+
+    color = (int *)itsol_malloc(n * sizeof(int), "mcolor");
+    mark = (int *)itsol_malloc((maxdeg + 1) * sizeof(int), "mcolor");
+    for (c = 0; c <= maxdeg; c++)
+        mark[c] = -1;
+    for (i = 0; i < n; i++)
+        color[i] = -1;
+
+    for (i = 0; i < n; i++) {
+        for (k = xadj[i]; k < xadj[i + 1]; k++)
+            if ((c = color[adj[k]]) >= 0) mark[c] = i;
+
+        for (c = 0; mark[c] == i; c++);
+        color[i] = c;
+        nc = its_max(nc, c + 1);
+    }
+
+    /*-------------------- colors one after the other */
+    cptr = (int *)itsol_malloc((nc + 1) * sizeof(int), "mcolor");
+    for (c = 0; c <= nc; c++)
+        cptr[c] = 0;
+    for (i = 0; i < n; i++)
+        cptr[color[i] + 1]++;
+    for (c = 0; c < nc; c++)
+        cptr[c + 1] += cptr[c];
+    for (i = 0; i < n; i++)
+        perm[i] = cptr[color[i]]++;
+
+    *ncolor = nc;
+
+    free(xadj);
+    free(adj);
+    free(color);
+    free(mark);
+    free(cptr);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+  | breadth first search from root: the nodes reached in list (returns
+  | how many), their level in lev. lev is -1 for all nodes on entry and
+  | is reset for the nodes reached by the caller. With lab, only the
+  | nodes with lab[j] == q are visited.
+  |--------------------------------------------------------------------*/
+static int bfs_(ITS_INT *xadj, int *adj, int *lab, int q, int root, int *lev, int *list)
+{
+    int head = 0, tail = 1, i, j;
+    ITS_INT k;
+
+    list[0] = root;
+    lev[root] = 0;
+    while (head < tail) {
+        i = list[head++];
+        for (k = xadj[i]; k < xadj[i + 1]; k++) {
+            j = adj[k];
+            if (lev[j] >= 0 || (lab != NULL && lab[j] != q)) continue;
+            lev[j] = lev[i] + 1;
+            list[tail++] = j;
+        }
+    }
+
+    return tail;
+}
+
+/* pseudo-peripheral node of the component of root (George and Liu):
+   restart from a node of smallest degree in the last level while the
+   number of levels grows */
+static int periph_(ITS_INT *xadj, int *adj, int *lab, int q, int root, int *lev, int *list)
+{
+    int i, k, cnt, nlev, best, x, nlev0 = -1;
+
+    for (;;) {
+        cnt = bfs_(xadj, adj, lab, q, root, lev, list);
+        nlev = lev[list[cnt - 1]] + 1;
+
+        x = -1;
+        best = 0;
+        for (k = cnt - 1; k >= 0 && lev[list[k]] == nlev - 1; k--) {
+            i = list[k];
+            if (x < 0 || xadj[i + 1] - xadj[i] < best) {
+                x = i;
+                best = (int)(xadj[i + 1] - xadj[i]);
+            }
+        }
+
+        for (k = 0; k < cnt; k++)
+            lev[list[k]] = -1;
+
+        if (nlev <= nlev0) break;
+        nlev0 = nlev;
+        root = x;
+    }
+
+    return root;
+}
+
+int itsol_rcm(ITS_SparMat *mat, int *perm)
+{
+    int i, j, c, n = mat->n, head, tail, t0, root, *adj, *deg, *byd, *lev, *list, *order;
+    ITS_INT k, *xadj;
+
+    sym_graph_(mat, &xadj, &adj);
+
+    deg = (int *)itsol_malloc(n * sizeof(int), "rcm");
+    byd = (int *)itsol_malloc((n + 1) * sizeof(int), "rcm");
+    lev = (int *)itsol_malloc(n * sizeof(int), "rcm");
+    list = (int *)itsol_malloc(n * sizeof(int), "rcm");
+    order = (int *)itsol_malloc(n * sizeof(int), "rcm");
+
+    /*-------------------- nodes by increasing degree, to start components */
+    for (i = 0; i <= n; i++)
+        byd[i] = 0;
+    for (i = 0; i < n; i++) {
+        deg[i] = (int)(xadj[i + 1] - xadj[i]);
+        byd[deg[i] + 1]++;
+    }
+    for (i = 0; i < n; i++)
+        byd[i + 1] += byd[i];
+    for (i = 0; i < n; i++)
+        list[byd[deg[i]]++] = i;
+
+    for (i = 0; i < n; i++)
+        lev[i] = -1;
+
+    /*-------------------- Cuthill-McKee, component by component */
+    head = tail = 0;
+    for (c = 0; c < n; c++) {
+        root = list[c];
+        if (lev[root] == -2) continue;
+
+        /* the component is not ordered yet: room for it after tail */
+        root = periph_(xadj, adj, NULL, 0, root, lev, order + tail);
+
+        order[tail++] = root;
+        lev[root] = -2;
+        while (head < tail) {
+            i = order[head++];
+            t0 = tail;
+            for (k = xadj[i]; k < xadj[i + 1]; k++) {
+                j = adj[k];
+                if (lev[j] == -2) continue;
+                lev[j] = -2;
+                order[tail++] = j;
+            }
+            /* neighbors by increasing degree */
+            for (j = t0 + 1; j < tail; j++) {
+                int v = order[j], m = j;
+
+                while (m > t0 && deg[order[m - 1]] > deg[v]) {
+                    order[m] = order[m - 1];
+                    m--;
+                }
+                order[m] = v;
+            }
+        }
+    }
+
+    /*-------------------- reversed */
+    for (k = 0; k < n; k++)
+        perm[order[k]] = n - 1 - (int)k;
+
+    free(xadj);
+    free(adj);
+    free(deg);
+    free(byd);
+    free(lev);
+    free(list);
+    free(order);
+
+    return 0;
+}
+
+/* append v to the list of length *len and capacity *cap */
+static void push_(int **list, int *len, int *cap, int v)
+{
+    int *t;
+
+    if (*len == *cap) {
+        *cap = *cap > 0 ? 2 * *cap : 4;
+        t = (int *)itsol_malloc(*cap * sizeof(int), "amd");
+        if (*len > 0) memcpy(t, *list, *len * sizeof(int));
+        free(*list);
+        *list = t;
+    }
+    (*list)[(*len)++] = v;
+}
+
+/*----------------------------------------------------------------------
+  | approximate minimum degree: minimum degree elimination on the
+  | quotient graph, where the eliminated nodes are elements (the cliques
+  | of their fill). Each variable i keeps its uneliminated neighbors A_i
+  | and its elements E_i, element e its variables L_e. The degrees are
+  | the upper bounds of Amestoy, Davis and Duff instead of the exact
+  | ones; there are no supervariables.
+  |--------------------------------------------------------------------*/
+int itsol_amd(ITS_SparMat *mat, int *perm)
+{
+    int n = mat->n, i, j, e, p, q, r, m, k, d, nlp, mindeg, stamp;
+    int *adj, *alen, *deg, *head, *next, *prev, *mark, *w, *wmark, *lp;
+    int *elen, *ecap, **elist, *llen, **lelem;
+    ITS_INT *xadj;
+    long dd;
+
+    sym_graph_(mat, &xadj, &adj);
+
+    alen = (int *)itsol_malloc(n * sizeof(int), "amd");
+    deg = (int *)itsol_malloc(n * sizeof(int), "amd");
+    head = (int *)itsol_malloc(n * sizeof(int), "amd");
+    next = (int *)itsol_malloc(n * sizeof(int), "amd");
+    prev = (int *)itsol_malloc(n * sizeof(int), "amd");
+    mark = (int *)itsol_malloc(n * sizeof(int), "amd");
+    w = (int *)itsol_malloc(n * sizeof(int), "amd");
+    wmark = (int *)itsol_malloc(n * sizeof(int), "amd");
+    lp = (int *)itsol_malloc(n * sizeof(int), "amd");
+    elen = (int *)itsol_malloc(n * sizeof(int), "amd");
+    ecap = (int *)itsol_malloc(n * sizeof(int), "amd");
+    llen = (int *)itsol_malloc(n * sizeof(int), "amd");
+    elist = (int **)itsol_malloc(n * sizeof(int *), "amd");
+    lelem = (int **)itsol_malloc(n * sizeof(int *), "amd");
+
+    /*-------------------- degree lists */
+    for (i = 0; i < n; i++) {
+        head[i] = -1;
+        mark[i] = wmark[i] = -1;
+        elen[i] = ecap[i] = llen[i] = 0;
+        elist[i] = lelem[i] = NULL;
+        perm[i] = -1;
+    }
+    for (i = 0; i < n; i++) {
+        alen[i] = deg[i] = (int)(xadj[i + 1] - xadj[i]);
+        prev[i] = -1;
+        next[i] = head[deg[i]];
+        if (next[i] >= 0) prev[next[i]] = i;
+        head[deg[i]] = i;
+    }
+
+    mindeg = 0;
+    for (k = 0; k < n; k++) {
+        /*-------------------- pivot of smallest degree */
+        while (head[mindeg] < 0) mindeg++;
+        p = head[mindeg];
+        head[mindeg] = next[p];
+        if (next[p] >= 0) prev[next[p]] = -1;
+        perm[p] = k;
+        stamp = k;
+
+        /*-------------------- Lp = A_p and the L_e of E_p, which p absorbs */
+        mark[p] = stamp;
+        nlp = 0;
+        for (q = 0; q < alen[p]; q++) {
+            j = adj[xadj[p] + q];
+            if (perm[j] < 0 && mark[j] != stamp) {
+                mark[j] = stamp;
+                lp[nlp++] = j;
+            }
+        }
+        for (q = 0; q < elen[p]; q++) {
+            e = elist[p][q];
+            if (lelem[e] == NULL) continue;
+            for (r = 0; r < llen[e]; r++) {
+                j = lelem[e][r];
+                if (perm[j] < 0 && mark[j] != stamp) {
+                    mark[j] = stamp;
+                    lp[nlp++] = j;
+                }
+            }
+            free(lelem[e]);
+            lelem[e] = NULL;
+        }
+        free(elist[p]);
+        elist[p] = NULL;
+
+        lelem[p] = (int *)itsol_malloc((nlp > 0 ? nlp : 1) * sizeof(int), "amd");
+        memcpy(lelem[p], lp, nlp * sizeof(int));
+        llen[p] = nlp;
+
+        /*-------------------- A_i without Lp (in element p now), E_i + p */
+        for (q = 0; q < nlp; q++) {
+            i = lp[q];
+            if (prev[i] >= 0)
+                next[prev[i]] = next[i];
+            else
+                head[deg[i]] = next[i];
+            if (next[i] >= 0) prev[next[i]] = prev[i];
+
+            for (m = r = 0; r < alen[i]; r++) {
+                j = adj[xadj[i] + r];
+                if (perm[j] < 0 && mark[j] != stamp) adj[xadj[i] + m++] = j;
+            }
+            alen[i] = m;
+
+            for (m = r = 0; r < elen[i]; r++)
+                if (lelem[elist[i][r]] != NULL) elist[i][m++] = elist[i][r];
+            elen[i] = m;
+            push_(&elist[i], &elen[i], &ecap[i], p);
+        }
+
+        /*-------------------- w(e) = |L_e \ Lp| for the other elements */
+        for (q = 0; q < nlp; q++) {
+            i = lp[q];
+            for (r = 0; r < elen[i] - 1; r++) {
+                e = elist[i][r];
+                if (wmark[e] != stamp) {
+                    wmark[e] = stamp;
+                    w[e] = llen[e];
+                }
+                w[e]--;
+            }
+        }
+
+        /*-------------------- approximate degrees; elements with
+                               L_e in Lp are absorbed into p */
+        for (q = 0; q < nlp; q++) {
+            i = lp[q];
+            dd = alen[i] + nlp - 1;
+            for (m = r = 0; r < elen[i]; r++) {
+                e = elist[i][r];
+                if (e != p) {
+                    if (w[e] == 0) {
+                        free(lelem[e]);
+                        lelem[e] = NULL;
+                        continue;
+                    }
+                    dd += w[e];
+                }
+                elist[i][m++] = e;
+            }
+            elen[i] = m;
+
+            d = n - k - 2;
+            if (deg[i] + nlp - 1 < d) d = deg[i] + nlp - 1;
+            if (dd < d) d = (int)dd;
+            deg[i] = d;
+
+            prev[i] = -1;
+            next[i] = head[d];
+            if (next[i] >= 0) prev[next[i]] = i;
+            head[d] = i;
+            if (d < mindeg) mindeg = d;
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        free(elist[i]);
+        free(lelem[i]);
+    }
+    free(xadj);
+    free(adj);
+    free(alen);
+    free(deg);
+    free(head);
+    free(next);
+    free(prev);
+    free(mark);
+    free(w);
+    free(wmark);
+    free(lp);
+    free(elen);
+    free(ecap);
+    free(llen);
+    free(elist);
+    free(lelem);
+
+    return 0;
+}
+
+/* splits part q (lab[i] == q, cnt nodes, root one of them) at a middle
+   level of a breadth first search from a pseudo-peripheral node: the
+   levels before it go to part 2q+1, the ones after it to 2q+2, the
+   middle level is the separator (lab -1, seplev = l). The nodes not
+   reached (other components) are moved to 2q+2 by the caller. */
+static void bisect_(ITS_INT *xadj, int *adj, int *lab, int q, int root, int cnt, int l,
+        int *seplev, int *lev, int *list)
+{
+    int k, m, nl, mid, i;
+
+    root = periph_(xadj, adj, lab, q, root, lev, list);
+    m = bfs_(xadj, adj, lab, q, root, lev, list);
+    nl = lev[list[m - 1]] + 1;
+
+    if (nl < 3) {
+        /* no separating level, the part stays whole */
+        for (k = 0; k < m; k++)
+            lab[list[k]] = 2 * q + 1;
+    }
+    else {
+        mid = lev[list[its_min(m - 1, cnt / 2)]];
+        mid = its_max(1, its_min(mid, nl - 2));
+
+        for (k = 0; k < m; k++) {
+            i = list[k];
+            if (lev[i] < mid)
+                lab[i] = 2 * q + 1;
+            else if (lev[i] > mid)
+                lab[i] = 2 * q + 2;
+            else {
+                lab[i] = -1;
+                seplev[i] = l;
+            }
+        }
+    }
+
+    for (k = 0; k < m; k++)
+        lev[list[k]] = -1;
+}
+
+/*----------------------------------------------------------------------
+  | nested dissection: nlev levels of bisection by level-structure
+  | separators, the parts of a level split independently. The
+  | subdomains (leaves) come first, in natural order within each, then
+  | the separators, the deepest level first.
+  |--------------------------------------------------------------------*/
+int itsol_nd(ITS_SparMat *mat, int nlev, int *perm, int *ndom, int **dom)
+{
+    int n = mat->n, i, k, l, q, base, np, nd, *adj, *lab, *seplev, *lev, *list, *first, *cnt,
+        *ptr;
+    ITS_INT *xadj;
+
+    nlev = its_max(0, its_min(nlev, 20));
+    np = 1 << nlev;
+
+    sym_graph_(mat, &xadj, &adj);
+
+    lab = (int *)itsol_malloc(n * sizeof(int), "nd");
+    seplev = (int *)itsol_malloc(n * sizeof(int), "nd");
+    lev = (int *)itsol_malloc(n * sizeof(int), "nd");
+    list = (int *)itsol_malloc(n * sizeof(int), "nd");
+    first = (int *)itsol_malloc(np * sizeof(int), "nd");
+    cnt = (int *)itsol_malloc((np + nlev) * sizeof(int), "nd");
+
+    for (i = 0; i < n; i++) {
+        lab[i] = 0;
+        seplev[i] = -1;
+        lev[i] = -1;
+    }
+
+    /*-------------------- bisection, level by level */
+    for (l = 0; l < nlev; l++) {
+        base = (1 << l) - 1;
+        for (k = 0; k < (1 << l); k++) {
+            first[k] = -1;
+            cnt[k] = 0;
+        }
+        for (i = 0; i < n; i++) {
+            if (lab[i] < base) continue;
+            k = lab[i] - base;
+            if (first[k] < 0) first[k] = i;
+            cnt[k]++;
+        }
+
+        for (k = 0; k < (1 << l); k++)
+            if (first[k] >= 0)
+                bisect_(xadj, adj, lab, base + k, first[k], cnt[k], l, seplev, lev, list);
+
+        for (i = 0; i < n; i++)
+            if (lab[i] >= base && lab[i] < base + (1 << l)) lab[i] = 2 * lab[i] + 2;
+    }
+
+    /*-------------------- leaves, the nonempty ones are the subdomains */
+    base = np - 1;
+    for (k = 0; k < np + nlev; k++)
+        cnt[k] = 0;
+    for (i = 0; i < n; i++) {
+        if (lab[i] >= 0)
+            cnt[lab[i] - base]++;
+        else
+            cnt[np + nlev - 1 - seplev[i]]++;
+    }
+
+    for (nd = k = 0; k < np; k++)
+        if (cnt[k] > 0) nd++;
+    ptr = (int *)itsol_malloc((nd + 1) * sizeof(int), "nd");
+
+    /* offsets: subdomains, then separators from the deepest level */
+    for (nd = k = 0, q = 0; k < np + nlev; k++) {
+        i = cnt[k];
+        if (k < np && i > 0) ptr[nd++] = q;
+        cnt[k] = q;
+        q += i;
+        if (k == np - 1) ptr[nd] = q;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (lab[i] >= 0)
+            perm[i] = cnt[lab[i] - base]++;
+        else
+            perm[i] = cnt[np + nlev - 1 - seplev[i]]++;
+    }
+
+    *ndom = nd;
+    *dom = ptr;
+
+    free(xadj);
+    free(adj);
+    free(lab);
+    free(seplev);
+    free(lev);
+    free(list);
+    free(first);
+    free(cnt);
+
+    return 0;
+}
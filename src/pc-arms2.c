@@ -43,7 +43,11 @@
   |       ipar[3]:=iout   if (iout > 0) statistics on the run are 
   |                       printed to FILE *ft
   |
-  |       ipar[4-9] NOT used [reserved for later use] - set to zero.
+  |       ipar[4]:=nchunk if (nchunk > 1) and ipar[1] == 0 the independent
+  |                       sets are built on nchunk graph slabs in parallel,
+  |                       see itsol_indsetC_par.
+  |
+  |       ipar[5-9] NOT used [reserved for later use] - set to zero.
   | 
   | The following set method options for arms2. Their default values can
   | all be set to zero if desired. 
@@ -230,6 +234,8 @@ int itsol_pc_arms2(ITS_SparMat *Amat, int *ipar, double *droptol, int *lfil, dou
         //     printf("  ipar1 = %d \n", ipar[1]);
         if (ipar[1] == 1)
             itsol_PQperm(schur, bsize, uwork, iwork, &nB, tolind);
+        else if (ipar[4] > 1)
+            itsol_indsetC_par(schur, bsize, iwork, &nB, tolind, ipar[4]);
         else
             itsol_indsetC(schur, bsize, iwork, &nB, tolind);
         /*---------------------------------------------------------------------
@@ -314,6 +320,18 @@ int itsol_pc_arms2(ITS_SparMat *Amat, int *ipar, double *droptol, int *lfil, dou
             return (1);
         }
 
+        /*-------------------- flat storage follows Amat */
+        if (Amat->ia) {
+            itsol_csflat(levc->L, 2);
+            itsol_csflat(levc->U, 2);
+            itsol_csflat(schur, 2);
+        }
+#ifdef ITSOL_USE_OPENMP
+        /*-------------------- level schedules for the threaded solves */
+        itsol_levsched(levc->L, 0);
+        itsol_levsched(levc->U, 1);
+#endif
+
         itsol_cleanCS(B);
     }
 
@@ -388,6 +406,15 @@ int itsol_pc_arms2(ITS_SparMat *Amat, int *ipar, double *droptol, int *lfil, dou
         return (1);
     }
 
+    if (Amat->ia) {
+        itsol_csflat(ilsch->L, 2);
+        itsol_csflat(ilsch->U, 2);
+    }
+#ifdef ITSOL_USE_OPENMP
+    itsol_levsched(ilsch->L, 0);
+    itsol_levsched(ilsch->U, 1);
+#endif
+
     /*-------------------- Last Schur complement no longer needed */
     itsol_cleanCS(schur);
 
@@ -418,6 +445,7 @@ void itsol_set_arms_pars(ITS_PARS *io, int Dscale, int *ipar, double *dropcoef,
 
     ipar[2] = io->Bsize;        /* smallest size allowed for last schur comp. */
     ipar[3] = 1;                /* whether or not to print statistics */
+    ipar[4] = io->indset_nchunk;    /* > 1: parallel independent sets */
 
     /*-------------------- interlevel methods */
     ipar[10] = 0;               /* Always do permutations - currently not used  */
@@ -1,6 +1,10 @@
 
 #include "pc-iluk.h"
 
+#ifdef ITSOL_USE_OPENMP
+#include <omp.h>
+#endif
+
 /*----------------------------------------------------------------------------
  * ILUK preconditioner
  * incomplete LU factorization with level of fill dropping
@@ -36,26 +40,175 @@
 int itsol_pc_ilukC(int lofM, ITS_SparMat *csmat, ITS_ILUSpar *lu, int milu, FILE * fp)
 {
     int ierr;
+
+    if ((ierr = itsol_pc_ilukC_symb(lofM, csmat, lu, fp)) != 0) return ierr;
+
+    return itsol_pc_ilukC_num(csmat, lu, milu, fp);
+}
+
+/*----------------------------------------------------------------------------
+ * symbolic phase of ILUK
+ *----------------------------------------------------------------------------
+ * Sets up lu with the patterns of L and U (levels of fill up to lofM),
+ * their storage and, with OpenMP, their level schedules. The values
+ * are computed by itsol_pc_ilukC_num.
+ *
+ * return 0 on success, -1 on an error in lofC.
+ *--------------------------------------------------------------------------*/
+int itsol_pc_ilukC_symb(int lofM, ITS_SparMat *csmat, ITS_ILUSpar *lu, FILE * fp)
+{
+    return itsol_pc_ilukC_symb_nd(lofM, csmat, lu, 0, NULL, fp);
+}
+
+/*----------------------------------------------------------------------------
+ * the same, rows dom[d] .. dom[d+1]-1 (d < ndom) in diagonal blocks not
+ * coupled to each other (itsol_nd). lu keeps them: with OpenMP the
+ * blocks are done in parallel here and in itsol_pc_ilukC_num.
+ *--------------------------------------------------------------------------*/
+int itsol_pc_ilukC_symb_nd(int lofM, ITS_SparMat *csmat, ITS_ILUSpar *lu, int ndom, int *dom,
+        FILE * fp)
+{
+    int i;
     int n = csmat->n;
-    int *jw, i, j, k, col, jpos, jrow;
-    ITS_SparMat *L, *U;
-    double *D;
-    double *milu_sum;
-    
+
     itsol_setupILU(lu, n);
-    L = lu->L;
-    U = lu->U;
-    D = lu->D;
+    itsol_setupILUdom(lu, ndom, dom);
 
     /* symbolic factorization to calculate level of fill index arrays */
-    if ((ierr = itsol_pc_lofC(lofM, csmat, lu, fp)) != 0) {
+    if (itsol_pc_lofC(lofM, csmat, lu, fp) != 0) {
       if (fp != NULL)
         fprintf(fp, "Error: lofC\n");
       return -1;
     }
+    /* flat storage follows csmat: one block for all rows of L and U */
+    if (csmat->ia) {
+        itsol_csflat(lu->L, 1);
+        itsol_csflat(lu->U, 1);
+    }
+    else {
+        for (i = 0; i < n; i++)
+            itsol_mallocRow(lu, i);
+    }
+#ifdef ITSOL_USE_OPENMP
+    /* level schedules for the threaded solves, from the pattern */
+    itsol_levsched(lu->L, 0);
+    itsol_levsched(lu->U, 1);
+#endif
+
+    return 0;
+}
+
+/* row i of the factors, rows < i it depends on are done. jw = -1 on
+   entry and on return. Returns -2 on a zero diagonal. */
+static int iluk_row_(ITS_SparMat *csmat, ITS_ILUSpar *lu, int i, int *jw, int milu, double *milu_sum)
+{
+    int j, k, col, jpos, jrow;
+    ITS_SparMat *L = lu->L, *U = lu->U;
+    double *D = lu->D;
+
+    /* setup array jw[], and initial i-th row */
+    for (j = 0; j < L->nzcount[i]; j++) {   /* initialize L part   */
+        col = L->ja[i][j];
+        jw[col] = j;
+        L->ma[i][j] = 0;
+    }
+    jw[i] = i;
+    D[i] = 0;               /* initialize diagonal */
+    for (j = 0; j < U->nzcount[i]; j++) {   /* initialize U part   */
+        col = U->ja[i][j];
+        jw[col] = j;
+        U->ma[i][j] = 0;
+    }
+
+    /* copy row from csmat into lu */
+    for (j = 0; j < csmat->nzcount[i]; j++) {
+        col = csmat->ja[i][j];
+        jpos = jw[col];
+        if (col < i)
+            L->ma[i][jpos] = csmat->ma[i][j];
+        else if (col == i)
+            D[i] = csmat->ma[i][j];
+        else
+            U->ma[i][jpos] = csmat->ma[i][j];
+    }
+
+    /* eliminate previous rows */
+    for (j = 0; j < L->nzcount[i]; j++) {
+        jrow = L->ja[i][j];
+        /* get the multiplier for row to be eliminated (jrow) */
+        L->ma[i][j] *= D[jrow];
+
+        /* combine current row and row jrow */
+        for (k = 0; k < U->nzcount[jrow]; k++) {
+            col = U->ja[jrow][k];
+            jpos = jw[col];
+            if (jpos == -1) {
+              if (milu != 0 && col != i)
+                milu_sum[i] += L->ma[i][j] * U->ma[jrow][k];
+              continue;
+            }
+
+            if (col < i)
+                L->ma[i][jpos] -= L->ma[i][j] * U->ma[jrow][k];
+            else if (col == i)
+                D[i] -= L->ma[i][j] * U->ma[jrow][k];
+            else
+                U->ma[i][jpos] -= L->ma[i][j] * U->ma[jrow][k];
+        }
+    }
+
+    /* reset double-pointer to -1 ( U-part) */
+    for (j = 0; j < L->nzcount[i]; j++) {
+        col = L->ja[i][j];
+        jw[col] = -1;
+    }
+    jw[i] = -1;
+    for (j = 0; j < U->nzcount[i]; j++) {
+        col = U->ja[i][j];
+        jw[col] = -1;
+    }
+
+    if (D[i] == 0) return -2;
+
+    if (milu != 0)
+      D[i] = 1.0 / (D[i] - milu_sum[i]);
+    else
+      D[i] = 1.0 / D[i];
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * numeric phase of ILUK
+ *----------------------------------------------------------------------------
+ * Refactors in place: the patterns of L and U (and the storage of their
+ * values) are the ones set up by itsol_pc_ilukC_symb, only the values of
+ * csmat may have changed since. Used directly to refactor a matrix with
+ * the same pattern, see itsol_solver_update_values.
+ *
+ * on entry:
+ * =========
+ * csmat    = matrix stored in SpaFmt format, same pattern as when lu
+ *            was set up
+ * lu       = ILUK factors from itsol_pc_ilukC
+ * milu     = whether to calculate modified ilu, 0-> no, 1->row
+ * fp       = file pointer for error log ( might be stderr )
+ *
+ * on return:
+ * ==========
+ * ierr     = return value.
+ *            ierr  = 0   --> successful return.
+ *            ierr  = -2  --> zero diagonal found
+ *--------------------------------------------------------------------------*/
+int itsol_pc_ilukC_num(ITS_SparMat *csmat, ITS_ILUSpar *lu, int milu, FILE * fp)
+{
+    int n = csmat->n;
+    int *jw, i, j, ierr = 0;
+    double *milu_sum = NULL;
+
     if (milu!=0)
       milu_sum  = (double *) itsol_malloc(n*sizeof(double), "ilutc 13" );
-    
+
     jw = lu->work;
     /* set indicator array jw to -1 */
     for (j = 0; j < n; j++) {
@@ -63,92 +216,170 @@ int itsol_pc_ilukC(int lofM, ITS_SparMat *csmat, ITS_ILUSpar *lu, int milu, FILE
 	if (milu != 0)
 	  milu_sum[j] = 0.0;
     }
-    /* beginning of main loop */
-    for (i = 0; i < n; i++) {
-        /* set up the i-th row accroding to the nonzero information from
-           symbolic factorization */
-        itsol_mallocRow(lu, i);
-
-        /* setup array jw[], and initial i-th row */
-        for (j = 0; j < L->nzcount[i]; j++) {   /* initialize L part   */
-            col = L->ja[i][j];
-            jw[col] = j;
-            L->ma[i][j] = 0;
-        }
-        jw[i] = i;
-        D[i] = 0;               /* initialize diagonal */
-        for (j = 0; j < U->nzcount[i]; j++) {   /* initialize U part   */
-            col = U->ja[i][j];
-            jw[col] = j;
-            U->ma[i][j] = 0;
-        }
 
-        /* copy row from csmat into lu */
-        for (j = 0; j < csmat->nzcount[i]; j++) {
-            col = csmat->ja[i][j];
-            jpos = jw[col];
-            if (col < i)
-                L->ma[i][jpos] = csmat->ma[i][j];
-            else if (col == i)
-                D[i] = csmat->ma[i][j];
-            else
-                U->ma[i][jpos] = csmat->ma[i][j];
+#ifdef ITSOL_USE_OPENMP
+    /* independent diagonal blocks, one at a time per thread, then the
+       rows after them */
+    if (lu->ndom > 1 && omp_get_max_threads() > 1 && !omp_in_parallel()) {
+        int d, nt = omp_get_max_threads(), *jws;
+
+        jws = (int *)itsol_malloc((size_t)nt * n * sizeof(int), "iluk num");
+        for (j = 0; j < nt * n; j++)
+            jws[j] = -1;
+
+#pragma omp parallel for private(i) schedule(dynamic, 1)
+        for (d = 0; d < lu->ndom; d++) {
+            int *tjw = jws + (size_t)omp_get_thread_num() * n;
+
+            for (i = lu->dom[d]; i < lu->dom[d + 1]; i++)
+                if (iluk_row_(csmat, lu, i, tjw, milu, milu_sum) != 0) {
+#pragma omp atomic write
+                    ierr = -2;
+                    break;
+                }
         }
 
-        /* eliminate previous rows */
-        for (j = 0; j < L->nzcount[i]; j++) {
-            jrow = L->ja[i][j];
-            /* get the multiplier for row to be eliminated (jrow) */
-            L->ma[i][j] *= D[jrow];
-
-            /* combine current row and row jrow */
-            for (k = 0; k < U->nzcount[jrow]; k++) {
-                col = U->ja[jrow][k];
-                jpos = jw[col];
-                if (jpos == -1) {
-		  if (milu != 0 && col != i)
-		    milu_sum[i] += L->ma[i][j] * U->ma[jrow][k];
-		  continue;
-		}
-
-                if (col < i)
-                    L->ma[i][jpos] -= L->ma[i][j] * U->ma[jrow][k];
-                else if (col == i)
-                    D[i] -= L->ma[i][j] * U->ma[jrow][k];
-                else
-                    U->ma[i][jpos] -= L->ma[i][j] * U->ma[jrow][k];
+        free(jws);
+        for (i = lu->dom[lu->ndom]; i < n && ierr == 0; i++)
+            ierr = iluk_row_(csmat, lu, i, jw, milu, milu_sum);
+    }
+    /* rows of a level of L only depend on rows of earlier levels: they
+       are factored in parallel, each thread with its own jw */
+    else if (lu->L->sched != NULL && omp_get_max_threads() > 1 && !omp_in_parallel()) {
+        ITS_LevSched *sc = lu->L->sched;
+        int l, k, nt = omp_get_max_threads(), *jws;
+
+        jws = (int *)itsol_malloc((size_t)nt * n * sizeof(int), "iluk num");
+        for (k = 0; k < nt * n; k++)
+            jws[k] = -1;
+
+#pragma omp parallel private(l, k)
+        {
+            int *tjw = jws + (size_t)omp_get_thread_num() * n;
+
+            for (l = 0; l < sc->nlev; l++) {
+#pragma omp for schedule(dynamic, ITS_OMP_LEVEL_ROWS)
+                for (k = sc->lev[l]; k < sc->lev[l + 1]; k++)
+                    if (iluk_row_(csmat, lu, sc->rows[k], tjw, milu, milu_sum) != 0) {
+#pragma omp atomic write
+                        ierr = -2;
+                    }
             }
         }
 
-        /* reset double-pointer to -1 ( U-part) */
-        for (j = 0; j < L->nzcount[i]; j++) {
-            col = L->ja[i][j];
-            jw[col] = -1;
+        free(jws);
+    }
+    else
+#endif
+    /* beginning of main loop */
+    for (i = 0; i < n; i++) {
+        if ((ierr = iluk_row_(csmat, lu, i, jw, milu, milu_sum)) != 0) break;
+    }
+
+    if (ierr != 0 && fp != NULL)
+        fprintf(fp, "fatal error: Zero diagonal found...\n");
+
+    if (milu != 0)
+      free(milu_sum);
+    return ierr;
+}
+
+/* pattern of row i of L and U, rows < i are done. iw = -1 on entry and
+   on return, levls and jbuf are n long. ulvl[i] gets the levels of the
+   U part. */
+static void lof_row_(int lofM, ITS_SparMat *csmat, ITS_ILUSpar *lu, int i, int **ulvl,
+        int *iw, int *levls, int *jbuf)
+{
+    int j, k, col, ip, it, jpiv;
+    int incl, incu, jmin, kmin;
+    ITS_SparMat *L = lu->L, *U = lu->U;
+
+    incl = 0;
+    incu = i;
+    /*-------------------- assign lof = 0 for matrix elements */
+    for (j = 0; j < csmat->nzcount[i]; j++) {
+        col = csmat->ja[i][j];
+        if (col < i) {
+            /*-------------------- L-part  */
+            jbuf[incl] = col;
+            levls[incl] = 0;
+            iw[col] = incl++;
         }
-        jw[i] = -1;
-        for (j = 0; j < U->nzcount[i]; j++) {
-            col = U->ja[i][j];
-            jw[col] = -1;
+        else if (col > i) {
+            /*-------------------- U-part  */
+            jbuf[incu] = col;
+            levls[incu] = 0;
+            iw[col] = incu++;
         }
-
-        if (D[i] == 0) {
-            for (j = i + 1; j < n; j++) {
-                L->ma[j] = NULL;
-                U->ma[j] = NULL;
+    }
+    /*-------------------- symbolic k,i,j Gaussian elimination  */
+    jpiv = -1;
+    while (++jpiv < incl) {
+        k = jbuf[jpiv];
+        /*-------------------- select leftmost pivot */
+        kmin = k;
+        jmin = jpiv;
+        for (j = jpiv + 1; j < incl; j++) {
+            if (jbuf[j] < kmin) {
+                kmin = jbuf[j];
+                jmin = j;
             }
-	    if (fp != NULL)
-	      fprintf(fp, "fatal error: Zero diagonal found...\n");
-            return -2;
         }
-	if (milu != 0)
-	  D[i] = 1.0 / (D[i] - milu_sum[i]);
-	else
-	  D[i] = 1.0 / D[i];
+        /*-------------------- swap  */
+        if (jmin != jpiv) {
+            jbuf[jpiv] = kmin;
+            jbuf[jmin] = k;
+            iw[kmin] = jpiv;
+            iw[k] = jmin;
+            j = levls[jpiv];
+            levls[jpiv] = levls[jmin];
+            levls[jmin] = j;
+            k = kmin;
+        }
+        /*-------------------- symbolic linear combinaiton of rows  */
+        for (j = 0; j < U->nzcount[k]; j++) {
+            col = U->ja[k][j];
+            it = ulvl[k][j] + levls[jpiv] + 1;
+            if (it > lofM)
+                continue;
+            ip = iw[col];
+            if (ip == -1) {
+                if (col < i) {
+                    jbuf[incl] = col;
+                    levls[incl] = it;
+                    iw[col] = incl++;
+                }
+                else if (col > i) {
+                    jbuf[incu] = col;
+                    levls[incu] = it;
+                    iw[col] = incu++;
+                }
+            }
+            else
+                levls[ip] = its_min(levls[ip], it);
+        }
+    }                       /* end - while loop */
+    /*-------------------- reset iw */
+    for (j = 0; j < incl; j++)
+        iw[jbuf[j]] = -1;
+    for (j = i; j < incu; j++)
+        iw[jbuf[j]] = -1;
+    /*-------------------- copy L-part */
+    L->nzcount[i] = incl;
+    if (incl > 0) {
+        L->ja[i] = (int *)itsol_malloc(incl * sizeof(int), "lofC");
+        memcpy(L->ja[i], jbuf, sizeof(int) * incl);
+    }
+    /*-------------------- copy U - part        */
+    k = incu - i;
+    U->nzcount[i] = k;
+    if (k > 0) {
+        U->ja[i] = (int *)itsol_malloc(sizeof(int) * k, "lofC");
+        memcpy(U->ja[i], jbuf + i, sizeof(int) * k);
+        /*-------------------- update matrix of levels */
+        ulvl[i] = (int *)itsol_malloc(k * sizeof(int), "lofC");
+        memcpy(ulvl[i], levls + i, k * sizeof(int));
     }
-
-   if (milu != 0)
-      free(milu_sum);
-   return 0;
 }
 
 /*--------------------------------------------------------------------
@@ -178,19 +409,15 @@ int itsol_pc_lofC(int lofM, ITS_SparMat *csmat, ITS_ILUSpar *lu, FILE * fp)
     int n = csmat->n;
     int *levls = NULL, *jbuf = NULL, *iw = lu->work;
     int **ulvl;                 /*  stores lev-fils for U part of ILU factorization */
-    ITS_SparMat *L = lu->L, *U = lu->U;
+    ITS_SparMat *U = lu->U;
 
     /*--------------------------------------------------------------------
      * n        = number of rows or columns in matrix
-     * inc      = integer, count of nonzero(fillin) element of each row
-     *            after symbolic factorization
-     * ju       = entry of U part of each row
      * lvl      = buffer to store levels of each row
      * jbuf     = buffer to store column index of each row
      * iw       = work array
      *------------------------------------------------------------------*/
-    int i, j, k, col, ip, it, jpiv;
-    int incl, incu, jmin, kmin;
+    int i, j, i0 = 0;
 
     (void)fp;
 
@@ -201,94 +428,35 @@ int itsol_pc_lofC(int lofM, ITS_SparMat *csmat, ITS_ILUSpar *lu, FILE * fp)
     /* initilize iw */
     for (j = 0; j < n; j++)
         iw[j] = -1;
-    for (i = 0; i < n; i++) {
-        incl = 0;
-        incu = i;
-        /*-------------------- assign lof = 0 for matrix elements */
-        for (j = 0; j < csmat->nzcount[i]; j++) {
-            col = csmat->ja[i][j];
-            if (col < i) {
-                /*-------------------- L-part  */
-                jbuf[incl] = col;
-                levls[incl] = 0;
-                iw[col] = incl++;
-            }
-            else if (col > i) {
-                /*-------------------- U-part  */
-                jbuf[incu] = col;
-                levls[incu] = 0;
-                iw[col] = incu++;
-            }
-        }
-        /*-------------------- symbolic k,i,j Gaussian elimination  */
-        jpiv = -1;
-        while (++jpiv < incl) {
-            k = jbuf[jpiv];
-            /*-------------------- select leftmost pivot */
-            kmin = k;
-            jmin = jpiv;
-            for (j = jpiv + 1; j < incl; j++) {
-                if (jbuf[j] < kmin) {
-                    kmin = jbuf[j];
-                    jmin = j;
-                }
-            }
-            /*-------------------- swap  */
-            if (jmin != jpiv) {
-                jbuf[jpiv] = kmin;
-                jbuf[jmin] = k;
-                iw[kmin] = jpiv;
-                iw[k] = jmin;
-                j = levls[jpiv];
-                levls[jpiv] = levls[jmin];
-                levls[jmin] = j;
-                k = kmin;
-            }
-            /*-------------------- symbolic linear combinaiton of rows  */
-            for (j = 0; j < U->nzcount[k]; j++) {
-                col = U->ja[k][j];
-                it = ulvl[k][j] + levls[jpiv] + 1;
-                if (it > lofM)
-                    continue;
-                ip = iw[col];
-                if (ip == -1) {
-                    if (col < i) {
-                        jbuf[incl] = col;
-                        levls[incl] = it;
-                        iw[col] = incl++;
-                    }
-                    else if (col > i) {
-                        jbuf[incu] = col;
-                        levls[incu] = it;
-                        iw[col] = incu++;
-                    }
-                }
-                else
-                    levls[ip] = its_min(levls[ip], it);
-            }
-        }                       /* end - while loop */
-        /*-------------------- reset iw */
-        for (j = 0; j < incl; j++)
-            iw[jbuf[j]] = -1;
-        for (j = i; j < incu; j++)
-            iw[jbuf[j]] = -1;
-        /*-------------------- copy L-part */
-        L->nzcount[i] = incl;
-        if (incl > 0) {
-            L->ja[i] = (int *)itsol_malloc(incl * sizeof(int), "lofC");
-            memcpy(L->ja[i], jbuf, sizeof(int) * incl);
-        }
-        /*-------------------- copy U - part        */
-        k = incu - i;
-        U->nzcount[i] = k;
-        if (k > 0) {
-            U->ja[i] = (int *)itsol_malloc(sizeof(int) * k, "lofC");
-            memcpy(U->ja[i], jbuf + i, sizeof(int) * k);
-            /*-------------------- update matrix of levels */
-            ulvl[i] = (int *)itsol_malloc(k * sizeof(int), "lofC");
-            memcpy(ulvl[i], levls + i, k * sizeof(int));
+
+#ifdef ITSOL_USE_OPENMP
+    /* independent diagonal blocks in parallel, each thread with its own
+       work arrays */
+    if (lu->ndom > 1 && omp_get_max_threads() > 1 && !omp_in_parallel()) {
+        int d, nt = omp_get_max_threads(), *iws, *lvs, *jbs;
+
+        iws = (int *)itsol_malloc((size_t)nt * n * sizeof(int), "lofC");
+        lvs = (int *)itsol_malloc((size_t)nt * n * sizeof(int), "lofC");
+        jbs = (int *)itsol_malloc((size_t)nt * n * sizeof(int), "lofC");
+        for (j = 0; j < nt * n; j++)
+            iws[j] = -1;
+
+#pragma omp parallel for private(i) schedule(dynamic, 1)
+        for (d = 0; d < lu->ndom; d++) {
+            size_t o = (size_t)omp_get_thread_num() * n;
+
+            for (i = lu->dom[d]; i < lu->dom[d + 1]; i++)
+                lof_row_(lofM, csmat, lu, i, ulvl, iws + o, lvs + o, jbs + o);
         }
+
+        free(iws);
+        free(lvs);
+        free(jbs);
+        i0 = lu->dom[lu->ndom];
     }
+#endif
+    for (i = i0; i < n; i++)
+        lof_row_(lofM, csmat, lu, i, ulvl, iw, levls, jbuf);
 
     /*-------------------- free temp space and leave --*/
     free(levls);
@@ -1,6 +1,211 @@
 
 #include "pc-ilut.h"
 
+#ifdef ITSOL_USE_OPENMP
+#include <omp.h>
+#endif
+
+/* row i of the factors, the rows it depends on are done. iw = -1 on
+   entry and on return, jbuf, wn and w are n long. Returns -2 on a zero
+   row or diagonal. */
+static int ilut_row_(ITS_SparMat *csmat, ITS_ILUSpar *lu, int i, int lfil, double tol,
+        int *iw, int *jbuf, double *wn, double *w, FILE * fp)
+{
+    int len, lenu, lenl;
+    int nzcount, *ja, j, k;
+    int col, jpos, jrow, upos;
+    double t, tnorm, tolnorm, fact, lxu, *ma;
+    ITS_SparMat *L = lu->L, *U = lu->U;
+    double *D = lu->D;
+
+    nzcount = csmat->nzcount[i];
+    ja = csmat->ja[i];
+    ma = csmat->ma[i];
+    tnorm = 0;
+
+    for (j = 0; j < nzcount; j++) {
+        tnorm += fabs(ma[j]);
+    }
+
+    if (tnorm == 0.0) {
+        fprintf(fp, "ilut: zero row encountered.\n");
+        return -2;
+    }
+
+    tnorm /= (double)nzcount;
+    tolnorm = tol * tnorm;
+
+    /* unpack L-part and U-part of column of A in arrays w */
+    lenu = 0;
+    lenl = 0;
+    jbuf[i] = i;
+    w[i] = 0;
+    iw[i] = i;
+    for (j = 0; j < nzcount; j++) {
+        col = ja[j];
+        t = ma[j];
+        if (col < i) {
+            iw[col] = lenl;
+            jbuf[lenl] = col;
+            w[lenl] = t;
+            lenl++;
+        }
+        else if (col == i) {
+            w[i] = t;
+        }
+        else {
+            lenu++;
+            jpos = i + lenu;
+            iw[col] = jpos;
+            jbuf[jpos] = col;
+            w[jpos] = t;
+        }
+    }
+
+    j = -1;
+    len = 0;
+    /* eliminate previous rows */
+    while (++j < lenl) {
+        /*----------------------------------------------------------------------------
+         *  in order to do the elimination in the correct order we must select the
+         *  smallest column index among jbuf[k], k = j+1, ..., lenl
+         *--------------------------------------------------------------------------*/
+        jrow = jbuf[j];
+        jpos = j;
+
+        /* determine smallest column index */
+        for (k = j + 1; k < lenl; k++) {
+            if (jbuf[k] < jrow) {
+                jrow = jbuf[k];
+                jpos = k;
+            }
+        }
+
+        if (jpos != j) {
+            col = jbuf[j];
+            jbuf[j] = jbuf[jpos];
+            jbuf[jpos] = col;
+            iw[jrow] = j;
+            iw[col] = jpos;
+            t = w[j];
+            w[j] = w[jpos];
+            w[jpos] = t;
+        }
+
+        /* get the multiplier */
+        fact = w[j] * D[jrow];
+        w[j] = fact;
+        /* zero out element in row by resetting iw(n+jrow) to -1 */
+        iw[jrow] = -1;
+
+        /* combine current row and row jrow */
+        nzcount = U->nzcount[jrow];
+        ja = U->ja[jrow];
+        ma = U->ma[jrow];
+        for (k = 0; k < nzcount; k++) {
+            col = ja[k];
+            jpos = iw[col];
+            lxu = -fact * ma[k];
+            /* if fill-in element is small then disregard */
+            if (fabs(lxu) < tolnorm && jpos == -1)
+                continue;
+
+            if (col < i) {
+                /* dealing with lower part */
+                if (jpos == -1) {
+                    /* this is a fill-in element */
+                    jbuf[lenl] = col;
+                    iw[col] = lenl;
+                    w[lenl] = lxu;
+                    lenl++;
+                }
+                else {
+                    w[jpos] += lxu;
+                }
+
+            }
+            else {
+                /* dealing with upper part */
+                //          if( jpos == -1 ) {
+                if (jpos == -1 && fabs(lxu) > tolnorm) {
+                    /* this is a fill-in element */
+                    lenu++;
+                    upos = i + lenu;
+                    jbuf[upos] = col;
+                    iw[col] = upos;
+                    w[upos] = lxu;
+                }
+                else {
+                    w[jpos] += lxu;
+                }
+            }
+        }
+    }
+
+    /* restore iw */
+    iw[i] = -1;
+    for (j = 0; j < lenu; j++) {
+        iw[jbuf[i + j + 1]] = -1;
+    }
+
+        /*---------- case when diagonal is zero */
+    if (w[i] == 0.0) {
+        fprintf(fp, "zero diagonal encountered.\n");
+        return -2;
+    }
+
+        /*-----------Update diagonal */
+    D[i] = 1 / w[i];
+
+    /* update L-matrix */
+    //    len = min( lenl, lfil );
+    len = lenl < lfil ? lenl : lfil;
+    for (j = 0; j < lenl; j++) {
+        wn[j] = fabs(w[j]);
+        iw[j] = j;
+    }
+    FC_FUNC(itsol_qsplit,ITSOL_QSPLIT)(wn, iw, &lenl, &len);
+    L->nzcount[i] = len;
+    if (len > 0) {
+        ja = L->ja[i] = (int *)itsol_malloc(len * sizeof(int), "ilut");
+        ma = L->ma[i] = (double *)itsol_malloc(len * sizeof(double), "ilut");
+    }
+    for (j = 0; j < len; j++) {
+        jpos = iw[j];
+        ja[j] = jbuf[jpos];
+        ma[j] = w[jpos];
+    }
+    for (j = 0; j < lenl; j++)
+        iw[j] = -1;
+
+    /* update U-matrix */
+    //    len = min( lenu, lfil );
+    len = lenu < lfil ? lenu : lfil;
+    for (j = 0; j < lenu; j++) {
+        wn[j] = fabs(w[i + j + 1]);
+        iw[j] = i + j + 1;
+    }
+
+    FC_FUNC(itsol_qsplit,ITSOL_QSPLIT)(wn, iw, &lenu, &len);
+    U->nzcount[i] = len;
+    if (len > 0) {
+        ja = U->ja[i] = (int *)itsol_malloc(len * sizeof(int), "ilut");
+        ma = U->ma[i] = (double *)itsol_malloc(len * sizeof(double), "ilut");
+    }
+
+    for (j = 0; j < len; j++) {
+        jpos = iw[j];
+        ja[j] = jbuf[jpos];
+        ma[j] = w[jpos];
+    }
+
+    for (j = 0; j < lenu; j++) {
+        iw[j] = -1;
+    }
+
+    return 0;
+}
+
 /*----------------------------------------------------------------------------
  * ILUT preconditioner
  * incomplete LU factorization with dual truncation mechanism
@@ -51,14 +256,23 @@
  * impredictible).
  *--------------------------------------------------------------------------*/
 int itsol_pc_ilut(ITS_SparMat *csmat, ITS_ILUSpar *lu, int lfil, double tol, FILE * fp)
+{
+    return itsol_pc_ilut_nd(csmat, lu, lfil, tol, 0, NULL, fp);
+}
+
+/*----------------------------------------------------------------------------
+ * ILUT with rows dom[d] .. dom[d+1]-1, d < ndom, in diagonal blocks not
+ * coupled to each other (itsol_nd): with OpenMP the blocks are factored
+ * in parallel, then the rows from dom[ndom] on. The factors are the
+ * ones of itsol_pc_ilut, for any number of threads.
+ *--------------------------------------------------------------------------*/
+int itsol_pc_ilut_nd(ITS_SparMat *csmat, ITS_ILUSpar *lu, int lfil, double tol, int ndom,
+        int *dom, FILE * fp)
 {
     int n = csmat->n;
-    int len, lenu, lenl;
-    int nzcount, *ja, *jbuf, *iw, i, j, k;
-    int col, jpos, jrow, upos;
-    double t, tnorm, tolnorm, fact, lxu, *wn, *ma, *w;
+    int *jbuf, *iw, i, i0 = 0, ierr = 0;
+    double *wn, *w;
     ITS_SparMat *L, *U;
-    double *D;
 
     if (lfil < 0) {
         fprintf(fp, "ilut: Illegal value for lfil.\n");
@@ -66,9 +280,16 @@ int itsol_pc_ilut(ITS_SparMat *csmat, ITS_ILUSpar *lu, int lfil, double tol, FIL
     }
 
     itsol_setupILU(lu, n);
+    itsol_setupILUdom(lu, ndom, dom);
     L = lu->L;
     U = lu->U;
-    D = lu->D;
+
+    /* rows not factored (errors) stay empty */
+    for (i = 0; i < n; i++) {
+        L->nzcount[i] = U->nzcount[i] = 0;
+        L->ja[i] = U->ja[i] = NULL;
+        L->ma[i] = U->ma[i] = NULL;
+    }
 
     iw = (int *)itsol_malloc(n * sizeof(int), "ilut");
     jbuf = (int *)itsol_malloc(n * sizeof(int), "ilut");
@@ -79,206 +300,61 @@ int itsol_pc_ilut(ITS_SparMat *csmat, ITS_ILUSpar *lu, int lfil, double tol, FIL
     for (i = 0; i < n; i++)
         iw[i] = -1;
 
-    /* beginning of main loop */
-    for (i = 0; i < n; i++) {
-        nzcount = csmat->nzcount[i];
-        ja = csmat->ja[i];
-        ma = csmat->ma[i];
-        tnorm = 0;
-
-        for (j = 0; j < nzcount; j++) {
-            tnorm += fabs(ma[j]);
-        }
-
-        if (tnorm == 0.0) {
-            fprintf(fp, "ilut: zero row encountered.\n");
-            return -2;
-        }
-
-        tnorm /= (double)nzcount;
-        tolnorm = tol * tnorm;
-
-        /* unpack L-part and U-part of column of A in arrays w */
-        lenu = 0;
-        lenl = 0;
-        jbuf[i] = i;
-        w[i] = 0;
-        iw[i] = i;
-        for (j = 0; j < nzcount; j++) {
-            col = ja[j];
-            t = ma[j];
-            if (col < i) {
-                iw[col] = lenl;
-                jbuf[lenl] = col;
-                w[lenl] = t;
-                lenl++;
-            }
-            else if (col == i) {
-                w[i] = t;
-            }
-            else {
-                lenu++;
-                jpos = i + lenu;
-                iw[col] = jpos;
-                jbuf[jpos] = col;
-                w[jpos] = t;
-            }
-        }
-
-        j = -1;
-        len = 0;
-        /* eliminate previous rows */
-        while (++j < lenl) {
-            /*----------------------------------------------------------------------------
-             *  in order to do the elimination in the correct order we must select the
-             *  smallest column index among jbuf[k], k = j+1, ..., lenl
-             *--------------------------------------------------------------------------*/
-            jrow = jbuf[j];
-            jpos = j;
-
-            /* determine smallest column index */
-            for (k = j + 1; k < lenl; k++) {
-                if (jbuf[k] < jrow) {
-                    jrow = jbuf[k];
-                    jpos = k;
-                }
-            }
-
-            if (jpos != j) {
-                col = jbuf[j];
-                jbuf[j] = jbuf[jpos];
-                jbuf[jpos] = col;
-                iw[jrow] = j;
-                iw[col] = jpos;
-                t = w[j];
-                w[j] = w[jpos];
-                w[jpos] = t;
-            }
-
-            /* get the multiplier */
-            fact = w[j] * D[jrow];
-            w[j] = fact;
-            /* zero out element in row by resetting iw(n+jrow) to -1 */
-            iw[jrow] = -1;
-
-            /* combine current row and row jrow */
-            nzcount = U->nzcount[jrow];
-            ja = U->ja[jrow];
-            ma = U->ma[jrow];
-            for (k = 0; k < nzcount; k++) {
-                col = ja[k];
-                jpos = iw[col];
-                lxu = -fact * ma[k];
-                /* if fill-in element is small then disregard */
-                if (fabs(lxu) < tolnorm && jpos == -1)
-                    continue;
-
-                if (col < i) {
-                    /* dealing with lower part */
-                    if (jpos == -1) {
-                        /* this is a fill-in element */
-                        jbuf[lenl] = col;
-                        iw[col] = lenl;
-                        w[lenl] = lxu;
-                        lenl++;
-                    }
-                    else {
-                        w[jpos] += lxu;
-                    }
-
-                }
-                else {
-                    /* dealing with upper part */
-                    //          if( jpos == -1 ) {
-                    if (jpos == -1 && fabs(lxu) > tolnorm) {
-                        /* this is a fill-in element */
-                        lenu++;
-                        upos = i + lenu;
-                        jbuf[upos] = col;
-                        iw[col] = upos;
-                        w[upos] = lxu;
-                    }
-                    else {
-                        w[jpos] += lxu;
-                    }
+#ifdef ITSOL_USE_OPENMP
+    /* one block at a time per thread, each with its own work arrays */
+    if (lu->ndom > 1 && omp_get_max_threads() > 1 && !omp_in_parallel()) {
+        int d, nt = omp_get_max_threads(), *iws, *jbufs;
+        double *wns, *ws;
+
+        iws = (int *)itsol_malloc((size_t)nt * n * sizeof(int), "ilut");
+        jbufs = (int *)itsol_malloc((size_t)nt * n * sizeof(int), "ilut");
+        wns = (double *)itsol_malloc((size_t)nt * n * sizeof(double), "ilut");
+        ws = (double *)itsol_malloc((size_t)nt * n * sizeof(double), "ilut");
+        for (i = 0; i < nt * n; i++)
+            iws[i] = -1;
+
+#pragma omp parallel for private(i) schedule(dynamic, 1)
+        for (d = 0; d < lu->ndom; d++) {
+            size_t o = (size_t)omp_get_thread_num() * n;
+
+            for (i = lu->dom[d]; i < lu->dom[d + 1]; i++)
+                if (ilut_row_(csmat, lu, i, lfil, tol, iws + o, jbufs + o, wns + o, ws + o, fp) != 0) {
+#pragma omp atomic write
+                    ierr = -2;
+                    break;
                 }
-            }
-        }
-
-        /* restore iw */
-        iw[i] = -1;
-        for (j = 0; j < lenu; j++) {
-            iw[jbuf[i + j + 1]] = -1;
-        }
-
-            /*---------- case when diagonal is zero */
-        if (w[i] == 0.0) {
-            fprintf(fp, "zero diagonal encountered.\n");
-            for (j = i; j < n; j++) {
-                L->ja[j] = NULL;
-                L->ma[j] = NULL;
-                U->ja[j] = NULL;
-                U->ma[j] = NULL;
-            }
-
-            return -2;
-        }
-
-            /*-----------Update diagonal */
-        D[i] = 1 / w[i];
-
-        /* update L-matrix */
-        //    len = min( lenl, lfil );
-        len = lenl < lfil ? lenl : lfil;
-        for (j = 0; j < lenl; j++) {
-            wn[j] = fabs(w[j]);
-            iw[j] = j;
-        }
-        FC_FUNC(itsol_qsplit,ITSOL_QSPLIT)(wn, iw, &lenl, &len);
-        L->nzcount[i] = len;
-        if (len > 0) {
-            ja = L->ja[i] = (int *)itsol_malloc(len * sizeof(int), "ilut");
-            ma = L->ma[i] = (double *)itsol_malloc(len * sizeof(double), "ilut");
-        }
-        for (j = 0; j < len; j++) {
-            jpos = iw[j];
-            ja[j] = jbuf[jpos];
-            ma[j] = w[jpos];
-        }
-        for (j = 0; j < lenl; j++)
-            iw[j] = -1;
-
-        /* update U-matrix */
-        //    len = min( lenu, lfil );
-        len = lenu < lfil ? lenu : lfil;
-        for (j = 0; j < lenu; j++) {
-            wn[j] = fabs(w[i + j + 1]);
-            iw[j] = i + j + 1;
-        }
-
-        FC_FUNC(itsol_qsplit,ITSOL_QSPLIT)(wn, iw, &lenu, &len);
-        U->nzcount[i] = len;
-        if (len > 0) {
-            ja = U->ja[i] = (int *)itsol_malloc(len * sizeof(int), "ilut");
-            ma = U->ma[i] = (double *)itsol_malloc(len * sizeof(double), "ilut");
-        }
-
-        for (j = 0; j < len; j++) {
-            jpos = iw[j];
-            ja[j] = jbuf[jpos];
-            ma[j] = w[jpos];
         }
 
-        for (j = 0; j < lenu; j++) {
-            iw[j] = -1;
-        }
+        free(iws);
+        free(jbufs);
+        free(wns);
+        free(ws);
+        i0 = lu->dom[lu->ndom];
     }
+#endif
+
+    /* beginning of main loop */
+    for (i = i0; i < n && ierr == 0; i++)
+        ierr = ilut_row_(csmat, lu, i, lfil, tol, iw, jbuf, wn, w, fp);
 
     free(iw);
     free(jbuf);
     free(wn);
     free(w);
 
+    if (ierr != 0) return ierr;
+
+    /* flat storage follows csmat */
+    if (csmat->ia) {
+        itsol_csflat(L, 2);
+        itsol_csflat(U, 2);
+    }
+#ifdef ITSOL_USE_OPENMP
+    /* level schedules for the threaded solves */
+    itsol_levsched(L, 0);
+    itsol_levsched(U, 1);
+#endif
+
     return 0;
 }
 
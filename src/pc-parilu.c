@@ -0,0 +1,246 @@
+
+#include "pc-parilu.h"
+
+#ifdef ITSOL_USE_OPENMP
+#include <omp.h>
+#endif
+
+/*----------------------------------------------------------------------------
+ * PARILU preconditioner
+ * ILU(k) factors computed by fixed-point sweeps over all the nonzeros
+ * (Chow and Patel) instead of the row by row elimination of ILUK
+ *----------------------------------------------------------------------------
+ * Parameters
+ *----------------------------------------------------------------------------
+ * on entry:
+ * =========
+ * lofM     = level of fill: the pattern of L and U is the one of ILUK
+ *            with this level (itsol_pc_lofC).
+ * nsweep   = number of fixed-point sweeps, 0 leaves the initial guess.
+ * csmat    = matrix stored in SpaFmt format
+ * lu       = pointer to a ILUSpar struct
+ * fp       = file pointer for error log ( might be stderr )
+ *
+ * on return:
+ * ==========
+ * ierr     = return value.
+ *            ierr  = 0   --> successful return.
+ *            ierr  = -1  --> error in lofC
+ *            ierr  = -2  --> zero diagonal found
+ * lu       = same layout as the factors of itsol_pc_ilukC: L with a
+ *            unit diagonal, D = inverted diagonal of U, U strict upper,
+ *            so that itsol_lusolC applies them.
+ *----------------------------------------------------------------------------
+ * Notes:
+ * ======
+ * All the diagonals of the input matrix must not be zero. With enough
+ * sweeps the factors are those of ILUK (the fixed point is the same),
+ * a few sweeps usually give a preconditioner of about the same quality.
+ *--------------------------------------------------------------------------*/
+int itsol_pc_parilu(int lofM, int nsweep, ITS_SparMat *csmat, ITS_ILUSpar *lu, FILE * fp)
+{
+    int ierr;
+
+    if ((ierr = itsol_pc_ilukC_symb(lofM, csmat, lu, fp)) != 0) return ierr;
+
+    return itsol_pc_parilu_num(nsweep, csmat, lu, fp);
+}
+
+/*----------------------------------------------------------------------------
+ * sum of l(i,k) * u(k,j) over k < kmax, for row i of L (columns lj,
+ * values lv, nl entries, sorted) and column j of U (rows ur[c0..c1),
+ * sorted, values uv[ui[c]])
+ *--------------------------------------------------------------------------*/
+static double dot_(int *lj, double *lv, int nl, int *ur, ITS_INT *ui, double *uv,
+        ITS_INT c0, ITS_INT c1, int kmax)
+{
+    double s = 0.;
+    int q = 0, kl, ku;
+    ITS_INT c = c0;
+
+    while (q < nl && c < c1) {
+        kl = lj[q];
+        ku = ur[c];
+        if (kl >= kmax || ku >= kmax) break;
+
+        if (kl == ku)
+            s += lv[q++] * uv[ui[c++]];
+        else if (kl < ku)
+            q++;
+        else
+            c++;
+    }
+
+    return s;
+}
+
+/*----------------------------------------------------------------------------
+ * numeric phase of PARILU
+ *----------------------------------------------------------------------------
+ * The patterns of L and U are those set up by itsol_pc_ilukC_symb (as
+ * for itsol_pc_ilukC_num, csmat may have new values since). Starting
+ * from L = A_L D_A^{-1}, U = A_U, every sweep computes for all the
+ * nonzeros at once
+ *
+ *     l(i,j) = (a(i,j) - sum_{k<j} l(i,k) u(k,j)) / u(j,j)     i > j
+ *     u(i,j) =  a(i,j) - sum_{k<i} l(i,k) u(k,j)               i <= j
+ *
+ * from the values of the previous sweep, so that rows are updated in
+ * parallel and the result does not depend on the number of threads.
+ *
+ * return 0 on success, -2 on a zero diagonal.
+ *--------------------------------------------------------------------------*/
+int itsol_pc_parilu_num(int nsweep, ITS_SparMat *csmat, ITS_ILUSpar *lu, FILE * fp)
+{
+    int n = csmat->n;
+    int i, j, p, s, col, ierr = 0, *jw, *ur;
+    ITS_INT nl, nu, nv, k, *lptr, *uptr, *ucp, *ui;
+    double *av, *v0, *v1, *vt, t;
+    ITS_SparMat *L = lu->L, *U = lu->U;
+
+#ifdef ITSOL_USE_OPENMP
+    int par = omp_get_max_threads() > 1 && !omp_in_parallel() && n >= ITS_OMP_MIN_ROWS;
+#endif
+
+    /* values of all sweeps in one array: L, then U, then the diagonal */
+    lptr = (ITS_INT *)itsol_malloc((n + 1) * sizeof(ITS_INT), "parilu");
+    uptr = (ITS_INT *)itsol_malloc((n + 1) * sizeof(ITS_INT), "parilu");
+    lptr[0] = uptr[0] = 0;
+    for (i = 0; i < n; i++) {
+        lptr[i + 1] = lptr[i] + L->nzcount[i];
+        uptr[i + 1] = uptr[i] + U->nzcount[i];
+    }
+    nl = lptr[n];
+    nu = uptr[n];
+    nv = nl + nu + n;
+
+    av = (double *)itsol_malloc(3 * nv * sizeof(double), "parilu");
+    v0 = av + nv;
+    v1 = v0 + nv;
+
+    /* U by columns, rows in increasing order */
+    ucp = (ITS_INT *)itsol_malloc((n + 1) * sizeof(ITS_INT), "parilu");
+    ur = (int *)itsol_malloc((nu > 0 ? nu : 1) * sizeof(int), "parilu");
+    ui = (ITS_INT *)itsol_malloc((nu > 0 ? nu : 1) * sizeof(ITS_INT), "parilu");
+
+    for (j = 0; j <= n; j++)
+        ucp[j] = 0;
+    for (i = 0; i < n; i++)
+        for (p = 0; p < U->nzcount[i]; p++)
+            ucp[U->ja[i][p] + 1]++;
+    for (j = 0; j < n; j++)
+        ucp[j + 1] += ucp[j];
+    for (i = 0; i < n; i++) {
+        for (p = 0; p < U->nzcount[i]; p++) {
+            col = U->ja[i][p];
+            k = ucp[col]++;
+            ur[k] = i;
+            ui[k] = nl + uptr[i] + p;
+        }
+    }
+    for (j = n; j > 0; j--)
+        ucp[j] = ucp[j - 1];
+    ucp[0] = 0;
+
+    /* A on the pattern of L + D + U, fill-ins are 0 */
+    jw = lu->work;
+    for (j = 0; j < n; j++)
+        jw[j] = -1;
+    for (k = 0; k < nv; k++)
+        av[k] = 0.;
+
+    for (i = 0; i < n; i++) {
+        for (p = 0; p < L->nzcount[i]; p++)
+            jw[L->ja[i][p]] = p;
+        for (p = 0; p < U->nzcount[i]; p++)
+            jw[U->ja[i][p]] = p;
+
+        for (p = 0; p < csmat->nzcount[i]; p++) {
+            col = csmat->ja[i][p];
+            if (col == i)
+                av[nl + nu + i] = csmat->ma[i][p];
+            else if (jw[col] == -1)
+                continue;
+            else if (col < i)
+                av[lptr[i] + jw[col]] = csmat->ma[i][p];
+            else
+                av[nl + uptr[i] + jw[col]] = csmat->ma[i][p];
+        }
+
+        for (p = 0; p < L->nzcount[i]; p++)
+            jw[L->ja[i][p]] = -1;
+        for (p = 0; p < U->nzcount[i]; p++)
+            jw[U->ja[i][p]] = -1;
+
+        if (av[nl + nu + i] == 0) ierr = -2;
+    }
+
+    if (ierr != 0) {
+        if (fp != NULL)
+            fprintf(fp, "fatal error: Zero diagonal found...\n");
+        goto done;
+    }
+
+    /*-------------------- initial guess */
+    memcpy(v0, av, nv * sizeof(double));
+    for (i = 0; i < n; i++)
+        for (p = 0; p < L->nzcount[i]; p++)
+            v0[lptr[i] + p] /= av[nl + nu + L->ja[i][p]];
+
+    /*-------------------- fixed-point sweeps, v0 -> v1 */
+    for (s = 0; s < nsweep; s++) {
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for private(j, p, t) schedule(dynamic, ITS_OMP_ROW_CHUNK) if (par)
+#endif
+        for (i = 0; i < n; i++) {
+            int *lj = L->ja[i], nli = L->nzcount[i];
+            double *lo = v0 + lptr[i];
+
+            for (p = 0; p < nli; p++) {
+                j = lj[p];
+                t = av[lptr[i] + p] - dot_(lj, lo, p, ur, ui, v0, ucp[j], ucp[j + 1], j);
+                v1[lptr[i] + p] = t / v0[nl + nu + j];
+            }
+
+            v1[nl + nu + i] = av[nl + nu + i] - dot_(lj, lo, nli, ur, ui, v0, ucp[i], ucp[i + 1], i);
+
+            for (p = 0; p < U->nzcount[i]; p++) {
+                j = U->ja[i][p];
+                v1[nl + uptr[i] + p] = av[nl + uptr[i] + p]
+                    - dot_(lj, lo, nli, ur, ui, v0, ucp[j], ucp[j + 1], i);
+            }
+        }
+
+        vt = v0;
+        v0 = v1;
+        v1 = vt;
+    }
+
+    /*-------------------- into lu, D inverted */
+    for (i = 0; i < n; i++) {
+        if (v0[nl + nu + i] == 0) {
+            if (fp != NULL)
+                fprintf(fp, "fatal error: Zero diagonal found...\n");
+            ierr = -2;
+            goto done;
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        for (p = 0; p < L->nzcount[i]; p++)
+            L->ma[i][p] = v0[lptr[i] + p];
+        for (p = 0; p < U->nzcount[i]; p++)
+            U->ma[i][p] = v0[nl + uptr[i] + p];
+        lu->D[i] = 1.0 / v0[nl + nu + i];
+    }
+
+done:
+    free(lptr);
+    free(uptr);
+    free(av);
+    free(ucp);
+    free(ur);
+    free(ui);
+
+    return ierr;
+}
@@ -101,7 +101,8 @@ int itsol_pc_vbilutC(ITS_VBSparMat *vbmat, ITS_VBILUSpar *lu, int lfil, double t
         }
         if (tnorm == 0.0) {
             fprintf(fp, "vbilut:  zero row encountered.\n");
-            return -2;
+            ierr = -2;
+            goto label99;
         }
         tolnorm = tol * tnorm;
 
@@ -295,25 +296,31 @@ int itsol_pc_vbilutC(ITS_VBSparMat *vbmat, ITS_VBILUSpar *lu, int lfil, double t
 
             if (ierr != 0) {
                 fprintf(fp, "singular block encountered.\n");
-                for (j = i + 1; j < n; j++) {
-                    D[j] = NULL;
-                    L->ja[j] = NULL;
-                    L->ba[j] = NULL;
-                    U->ja[j] = NULL;
-                    U->ba[j] = NULL;
-                }
-                return -2;
+                i++;
+                ierr = -2;
+                goto label99;
             }
             for (j = 0; j < lenu; j++) {
                 iw[jbuf[i + j]] = -1;
             }
         }
         lu->DiagOpt = 1;
+        ierr = 0;
+
+label99:
+        /*-------------------- rows i.. not reached, for cleanVBILU */
+        for (j = i; j < n; j++) {
+            D[j] = NULL;
+            L->ja[j] = NULL;
+            L->ba[j] = NULL;
+            U->ja[j] = NULL;
+            U->ba[j] = NULL;
+        }
         free(jbuf);
         free(buf_fact);
         free(buf_ns);
         free(xnrm);
         free(wn);
 
-        return 0;
+        return ierr;
     }
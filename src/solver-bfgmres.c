@@ -0,0 +1,371 @@
+
+#include "solver-bfgmres.h"
+
+#ifdef ITSOL_USE_OPENMP
+#include <omp.h>
+#endif
+
+#define  epsmac  1.0e-16
+
+/* columns handled together by the column kernels, their coefficients
+   are kept in registers */
+#define  COLBLK  8
+
+/*----------------------------------------------------------------------
+  | column-wise operations on p vectors of length n stored interleaved
+  +---------------------------------------------------------------------*/
+/* d[j] = (x_j, y_j) */
+static void col_dots(int n, int p, double *x, double *y, double *d)
+{
+    int i, j, j0, nb;
+    double acc[COLBLK], *xi, *yi;
+
+    for (j0 = 0; j0 < p; j0 += COLBLK) {
+        nb = its_min(COLBLK, p - j0);
+        for (j = 0; j < COLBLK; j++)
+            acc[j] = 0.0;
+
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for private(j, xi, yi) reduction(+:acc[:COLBLK]) if (n >= ITS_OMP_MIN_ROWS && !omp_in_parallel())
+#endif
+        for (i = 0; i < n; i++) {
+            xi = x + (size_t)i * p + j0;
+            yi = y + (size_t)i * p + j0;
+            for (j = 0; j < nb; j++)
+                acc[j] += xi[j] * yi[j];
+        }
+
+        for (j = 0; j < nb; j++)
+            d[j0 + j] = acc[j];
+    }
+}
+
+/* y_j = y_j + a[j] x_j */
+static void col_axpy(int n, int p, double *a, double *x, double *y)
+{
+    int i, j, j0, nb;
+    double la[COLBLK], *xi, *yi;
+
+    for (j0 = 0; j0 < p; j0 += COLBLK) {
+        nb = its_min(COLBLK, p - j0);
+        for (j = 0; j < nb; j++)
+            la[j] = a[j0 + j];
+
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for private(j, xi, yi) if (n >= ITS_OMP_MIN_ROWS && !omp_in_parallel())
+#endif
+        for (i = 0; i < n; i++) {
+            xi = x + (size_t)i * p + j0;
+            yi = y + (size_t)i * p + j0;
+            for (j = 0; j < nb; j++)
+                yi[j] += la[j] * xi[j];
+        }
+    }
+}
+
+/* x_j = a[j] x_j */
+static void col_scal(int n, int p, double *a, double *x)
+{
+    int i, j, j0, nb;
+    double la[COLBLK], *xi;
+
+    for (j0 = 0; j0 < p; j0 += COLBLK) {
+        nb = its_min(COLBLK, p - j0);
+        for (j = 0; j < nb; j++)
+            la[j] = a[j0 + j];
+
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for private(j, xi) if (n >= ITS_OMP_MIN_ROWS && !omp_in_parallel())
+#endif
+        for (i = 0; i < n; i++) {
+            xi = x + (size_t)i * p + j0;
+            for (j = 0; j < nb; j++)
+                xi[j] *= la[j];
+        }
+    }
+}
+
+/* y = A x, column by column through cx, cy when there is no SpMM;
+   timed and counted in Amat->stats */
+static void matvec_mv(ITS_SMat *Amat, int p, double *x, double *y, double *cx, double *cy)
+{
+    ITS_STATS *st = Amat->stats;
+    int i, j, n = Amat->n;
+    double t = 0;
+
+    if (st != NULL) t = itsol_get_time();
+
+    if (Amat->matvec_mv != NULL) {
+        Amat->matvec_mv(Amat, p, x, y);
+    }
+    else {
+        for (j = 0; j < p; j++) {
+            for (i = 0; i < n; i++)
+                cx[i] = x[(size_t)i * p + j];
+            Amat->matvec(Amat, cx, cy);
+            for (i = 0; i < n; i++)
+                y[(size_t)i * p + j] = cy[i];
+        }
+    }
+
+    if (st != NULL) {
+        st->t_matvec += itsol_get_time() - t;
+        st->nmatvec += p;
+    }
+}
+
+/* y = M^{-1} x, column by column through cx, cy when there is no
+   multi-vector apply; timed and counted in Amat->stats */
+static void precon_mv(ITS_SMat *Amat, ITS_PC *lu, int p, double *x, double *y, double *cx, double *cy)
+{
+    ITS_STATS *st = Amat->stats;
+    int i, j, n = Amat->n;
+    double t = 0;
+
+    if (st != NULL) t = itsol_get_time();
+
+    if (lu == NULL) {
+        memcpy(y, x, (size_t)n * p * sizeof(double));
+    }
+    else if (lu->precon_mv != NULL) {
+        lu->precon_mv(p, x, y, lu);
+    }
+    else {
+        for (j = 0; j < p; j++) {
+            for (i = 0; i < n; i++)
+                cx[i] = x[(size_t)i * p + j];
+            lu->precon(cx, cy, lu);
+            for (i = 0; i < n; i++)
+                y[(size_t)i * p + j] = cy[i];
+        }
+    }
+
+    if (st != NULL) {
+        st->t_precon += itsol_get_time() - t;
+        st->nprecon += p;
+    }
+}
+
+/*----------------------------------------------------------------------
+  |       *** Preconditioned FGMRES, p right-hand-sides at once ***
+  +-----------------------------------------------------------------------
+  | The p systems are solved by p FGMRES iterations run in lockstep:
+  | every column keeps the Arnoldi / Givens recurrences of
+  | itsol_solver_fgmres (its own Hessenberg matrix, rotations and
+  | residual), while the matvec and the preconditioning operation are
+  | done on all the columns at once. A column stops taking part in the
+  | Arnoldi process as soon as it has converged, its basis vectors are
+  | then zero.
+  +-----------------------------------------------------------------------
+  | see solver-bfgmres.h for the arguments.
+  +-----------------------------------------------------------------------
+  | internal work arrays, in ws:
+  |----------
+  | vv      = [im+1][n][p] Arnoldi bases
+  | z       = [im][n][p] preconditioned vectors
+  | hh      = [p][im+1][im+3] Arnoldi matrix, rotations and rhs of
+  |           each column
+  | beta, eps1, t = [p] residual norms, stopping norms, coefficients
+  | cx, cy  = [n] column buffers
+  +---------------------------------------------------------------------*/
+int itsol_solver_bfgmres(ITS_SMat *Amat, ITS_PC *lu, int p, double *rhs, double *sol, ITS_PARS io,
+        int *nits, double *res, ITS_WORK *ws)
+{
+    int n = Amat->n;
+    ITS_INT np = (ITS_INT)n * p;
+    int i, i1, ii, j, k, k1, c, its, im1, hlen, ptih, nact, imax, retval, ndot = 0;
+    int *act, *last;
+    double *vv, *z, *hh, *hc, *cs, *sn, *rs, *beta, *eps1, *t, *cx, *cy;
+    double tt, gam, bmax;
+    int im = io.restart, maxits = io.maxits;
+    FILE * fp = io.fp;
+    double tol = io.tol;
+    ITS_WORK local = {NULL, 0, NULL, 0};
+
+    im1 = im + 1;
+    hlen = im1 * (im + 3);
+    if (ws == NULL) ws = &local;
+
+    vv = itsol_getWORK(ws, im1 * np + im * np + p * hlen + 3 * p + 2 * n);
+    z = vv + im1 * np;
+    hh = z + im * np;
+    beta = hh + p * hlen;
+    eps1 = beta + p;
+    t = eps1 + p;
+    cx = t + p;
+    cy = cx + n;
+
+    act = (int *)itsol_malloc(2 * p * sizeof(int), "bfgmres:act");
+    last = act + p;
+
+    /*-------------------- outer loop starts here */
+    retval = 0;
+    its = 0;
+    bmax = 0.0;
+    for (c = 0; c < p; c++)
+        eps1[c] = 0.0;
+
+    while (its < maxits) {
+        /*-------------------- compute initial residual vectors */
+        matvec_mv(Amat, p, sol, vv, cx, cy);
+        for (k = 0; k < np; k++) vv[k] = rhs[k] - vv[k];
+
+        col_dots(n, p, vv, vv, beta);
+        ndot++;
+        bmax = 0.0;
+        for (c = 0; c < p; c++) {
+            beta[c] = sqrt(beta[c]);
+            bmax = its_max(bmax, beta[c]);
+        }
+
+        if (fp != NULL && its == 0)
+            if (io.verb > 0 && fp != NULL) fprintf(fp, "%8d   %10.2e\n", its, bmax);
+
+        if (its == 0)
+            for (c = 0; c < p; c++) eps1[c] = tol * beta[c];
+
+        /*-------------------- columns not yet converged take part */
+        nact = 0;
+        for (c = 0; c < p; c++) {
+            last[c] = -1;
+            act[c] = beta[c] > eps1[c];
+            t[c] = 0.0;
+            if (act[c]) {
+                nact++;
+                t[c] = 1.0 / beta[c];
+                hh[c * hlen + im1 * im + 2 * im1] = beta[c];   /* rs[0] */
+            }
+        }
+
+        if (nact == 0) break;
+
+        /*--------------------   normalize:  vv    =  vv   / beta */
+        col_scal(n, p, t, vv);
+
+        /*-------------------- Krylov loop*/
+        i = -1;
+
+        while ((i < im - 1) && (nact > 0) && (its++ < maxits)) {
+            i++;
+            i1 = i + 1;
+            ptih = i * im1;
+
+            /*-------------------- z_{i} = M^{-1} v_{i}, v_{i+1} = A z_{i} */
+            precon_mv(Amat, lu, p, vv + i * np, z + i * np, cx, cy);
+            matvec_mv(Amat, p, z + i * np, vv + i1 * np, cx, cy);
+
+            /*-------------------- modified gram - schmidt, all columns */
+            for (j = 0; j <= i; j++) {
+                col_dots(n, p, vv + j * np, vv + i1 * np, t);
+                for (c = 0; c < p; c++) {
+                    if (act[c]) hh[c * hlen + ptih + j] = t[c];
+                    t[c] = -t[c];
+                }
+                col_axpy(n, p, t, vv + j * np, vv + i1 * np);
+            }
+            ndot += i + 1;
+
+            /*-------------------- h_{j+1,j} = ||w||_{2}, v_{j+1} = w / h_{j+1,j}
+              inactive columns and breakdowns give a zero vector */
+            col_dots(n, p, vv + i1 * np, vv + i1 * np, t);
+            ndot++;
+            for (c = 0; c < p; c++) {
+                tt = sqrt(t[c]);
+                if (act[c]) hh[c * hlen + ptih + i1] = tt;
+                t[c] = (act[c] && tt != 0.0) ? 1.0 / tt : 0.0;
+            }
+            col_scal(n, p, t, vv + i1 * np);
+
+            /*-------- update the factorization of each active hh */
+            bmax = 0.0;
+            for (c = 0; c < p; c++) {
+                if (!act[c]) continue;
+
+                hc = hh + c * hlen;
+                cs = hc + im1 * im;
+                sn = cs + im1;
+                rs = sn + im1;
+
+                for (k = 1; k <= i; k++) {
+                    k1 = k - 1;
+                    tt = hc[ptih + k1];
+                    hc[ptih + k1] = cs[k1] * tt + sn[k1] * hc[ptih + k];
+                    hc[ptih + k] = -sn[k1] * tt + cs[k1] * hc[ptih + k];
+                }
+
+                gam = sqrt(pow(hc[ptih + i], 2) + pow(hc[ptih + i1], 2));
+
+                /*-------------------- check if gamma is zero */
+                if (gam == 0.0) gam = epsmac;
+
+                /*-------------------- get  next plane rotation    */
+                cs[i] = hc[ptih + i] / gam;
+                sn[i] = hc[ptih + i1] / gam;
+                rs[i1] = -sn[i] * rs[i];
+                rs[i] = cs[i] * rs[i];
+
+                /*-------------------- get residual norm + test convergence*/
+                hc[ptih + i] = cs[i] * hc[ptih + i] + sn[i] * hc[ptih + i1];
+                beta[c] = fabs(rs[i1]);
+                last[c] = i;
+                bmax = its_max(bmax, beta[c]);
+
+                if (beta[c] <= eps1[c] || hc[ptih + i1] == 0.0) {
+                    act[c] = 0;
+                    nact--;
+                }
+            }
+
+            if (fp != NULL && io.verb > 0) fprintf(fp, "%8d   %10.2e\n", its, bmax);
+        }
+
+        /*-------------------- solve the upper triangular systems */
+        imax = -1;
+        for (c = 0; c < p; c++) {
+            i = last[c];
+            if (i < 0) continue;
+            imax = its_max(imax, i);
+
+            hc = hh + c * hlen;
+            rs = hc + im1 * im + 2 * im1;
+
+            rs[i] = rs[i] / hc[i * im1 + i];
+            for (ii = i - 1; ii >= 0; ii--) {
+                tt = rs[ii];
+                for (j = ii + 1; j <= i; j++)
+                    tt -= hc[j * im1 + ii] * rs[j];
+                rs[ii] = tt / hc[ii * im1 + ii];
+            }
+        }
+
+        /*---------- linear combination of z_j's to get sol. */
+        for (j = 0; j <= imax; j++) {
+            for (c = 0; c < p; c++)
+                t[c] = j <= last[c] ? hh[c * hlen + im1 * im + 2 * im1 + j] : 0.0;
+            col_axpy(n, p, t, z + j * np, sol);
+        }
+
+        /*--------------------  restart outer loop if needed */
+        bmax = 0.0;
+        nact = 0;
+        for (c = 0; c < p; c++) {
+            bmax = its_max(bmax, beta[c]);
+            if (beta[c] >= eps1[c] && beta[c] > 0.0) nact++;
+        }
+
+        if (nact == 0)
+            break;
+        else if (its >= maxits)
+            retval = 1;
+    }
+
+    if (nits != NULL) *nits = its;
+    if (res != NULL) *res = bmax;
+
+    if (Amat->stats != NULL) Amat->stats->ndot += (long)ndot * p;
+
+    free(act);
+    if (ws == &local) itsol_cleanWORK(&local);
+
+    return retval;
+}
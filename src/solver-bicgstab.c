@@ -3,28 +3,37 @@
 
 int itsol_solver_bicgstab(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, ITS_PARS io,
         int *nits, double *res)
+{
+    return itsol_solver_bicgstab_ws(Amat, lu, rhs, x, io, nits, res, NULL);
+}
+
+int itsol_solver_bicgstab_ws(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, ITS_PARS io,
+        int *nits, double *res, ITS_WORK *ws)
 {
     double *rg, *rh, *pg, *ph, *sg, *sh, *tg, *vg, *tp;
     double r0 = 0, r1 = 0, pra = 0, prb = 0, prc = 0;
     double residual, err_rel = 0;
-    int i, n, retval = 0;
+    int i, n, retval = 0, ndot = 0;
     int itr = 0.;
     double tol = io.tol;
     int maxits = io.maxits;
     FILE * fp = io.fp;
+    ITS_WORK local = {NULL, 0, NULL, 0};
 
     n = Amat->n;
-    rg = itsol_malloc(n * sizeof(double), "bicgstab");
-    rh = itsol_malloc(n * sizeof(double), "bicgstab");
-    pg = itsol_malloc(n * sizeof(double), "bicgstab");
-    ph = itsol_malloc(n * sizeof(double), "bicgstab");
-    sg = itsol_malloc(n * sizeof(double), "bicgstab");
-    sh = itsol_malloc(n * sizeof(double), "bicgstab");
-    tg = itsol_malloc(n * sizeof(double), "bicgstab");
-    vg = itsol_malloc(n * sizeof(double), "bicgstab");
-    tp = itsol_malloc(n * sizeof(double), "bicgstab");
-
-    Amat->matvec(Amat, x, tp);
+    if (ws == NULL) ws = &local;
+
+    rg = itsol_getWORK(ws, (ITS_INT)9 * n);
+    rh = rg + n;
+    pg = rh + n;
+    ph = pg + n;
+    sg = ph + n;
+    sh = sg + n;
+    tg = sh + n;
+    vg = tg + n;
+    tp = vg + n;
+
+    itsol_matvec_st(Amat, x, tp);
     for (i = 0; i < n; i++) rg[i] = rhs[i] - tp[i];
 
     for (i = 0; i < n; i++) {
@@ -33,12 +42,14 @@ int itsol_solver_bicgstab(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, IT
     }
 
     residual = err_rel = itsol_norm(rg, n);
+    ndot++;
     tol = residual * fabs(tol);
 
     if (tol == 0.) goto skip;
 
     for (itr = 0; itr < maxits; itr++) {
         r1 = itsol_dot(rg, rh, n);
+        ndot++;
 
         if (r1 == 0) {
             if (io.verb > 0 && fp != NULL) fprintf(fp, "solver bicgstab failed.\n");
@@ -60,16 +71,12 @@ int itsol_solver_bicgstab(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, IT
         r0 = r1;
 
         /*  pc */
-        if (lu == NULL) {
-            memcpy(ph, pg, n * sizeof(double));
-        }
-        else {
-            lu->precon(pg, ph, lu);
-        }
+        itsol_precon_st(Amat, lu, pg, ph);
 
-        Amat->matvec(Amat, ph, vg);
+        itsol_matvec_st(Amat, ph, vg);
 
         pra = r1 / itsol_dot(rh, vg, n);
+        ndot += 2;
         for (i = 0; i < n; i++) {
             sg[i] = rg[i] - pra * vg[i];
         }
@@ -79,29 +86,27 @@ int itsol_solver_bicgstab(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, IT
                 x[i] = x[i] + pra * ph[i];
             }
 
-            Amat->matvec(Amat, x, tp);
+            itsol_matvec_st(Amat, x, tp);
             for (i = 0; i < n; i++) rg[i] = rhs[i] - tp[i];
             residual = itsol_norm(rg, n);
+            ndot++;
 
             break;
         }
 
-        if (lu == NULL) {
-            memcpy(sh, sg, n * sizeof(double));
-        }
-        else {
-            lu->precon(sg, sh, lu);
-        }
+        itsol_precon_st(Amat, lu, sg, sh);
 
-        Amat->matvec(Amat, sh, tg);
+        itsol_matvec_st(Amat, sh, tg);
 
         prc = itsol_dot(tg, sg, n) / itsol_dot(tg, tg, n);
+        ndot += 3;
         for (i = 0; i < n; i++) {
             x[i] = x[i] + pra * ph[i] + prc * sh[i];
             rg[i] = sg[i] - prc * tg[i];
         }
 
         residual = itsol_norm(rg, n);
+        ndot++;
 
         if (io.verb > 0 && fp != NULL) fprintf(fp, "%8d   %10.2e\n", itr, residual / err_rel);
 
@@ -111,15 +116,8 @@ int itsol_solver_bicgstab(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, IT
     if (itr < maxits) itr += 1;
 
 skip:
-    free(rg);
-    free(rh);
-    free(pg);
-    free(ph);
-    free(sg);
-    free(sh);
-    free(tg);
-    free(tp);
-    free(vg);
+    if (Amat->stats != NULL) Amat->stats->ndot += ndot;
+    if (ws == &local) itsol_cleanWORK(&local);
 
     if (itr >= maxits) retval = 1;
     if (nits != NULL) *nits = itr;
@@ -3,6 +3,12 @@
 
 int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, ITS_PARS io,
         int *nits, double *res)
+{
+    return itsol_solver_bicgstabl_ws(Amat, lu, rhs, x, io, nits, res, NULL);
+}
+
+int itsol_solver_bicgstabl_ws(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, ITS_PARS io,
+        int *nits, double *res, ITS_WORK *ws)
 {
     int iter;
 
@@ -14,11 +20,12 @@ int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, I
     double nu;
     int z_dim;
     int l, i, j, n, k;
-    int end_solve;
+    int end_solve, ndot = 0;
     int bgsl = io.bgsl;
     double tol = io.tol;
     int maxits = io.maxits;
     FILE * fp = io.fp;
+    ITS_WORK local = {NULL, 0, NULL, 0};
 
     assert(x != NULL);
     assert(rhs != NULL);
@@ -29,26 +36,30 @@ int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, I
 
     z_dim = l + 1;
     n = Amat->n;
-    rtld = itsol_malloc(n * sizeof(double), "bicgstabl");
-    xp = itsol_malloc(n * sizeof(double), "bicgstabl");
-    bp = itsol_malloc(n * sizeof(double), "bicgstabl");
-    t = itsol_malloc(n * sizeof(double), "bicgstabl");
-    tp = itsol_malloc(n * sizeof(double), "bicgstabl");
-
-    r = itsol_malloc(sizeof(*r) * (l + 1), "bicgstabl");
-    for (i = 0; i <= l; i++) r[i] = itsol_malloc(n * sizeof(double), "bicgstabl");
-
-    u = itsol_malloc(sizeof(*u) * (l + 1), "bicgstabl");
-    for (i = 0; i <= l; i++) u[i] = itsol_malloc(n * sizeof(double), "bicgstabl");
+    if (ws == NULL) ws = &local;
+
+    /* 5 + 2 (l + 1) vectors and the small dense arrays in one block */
+    rtld = itsol_getWORK(ws, (ITS_INT)(5 + 2 * (l + 1)) * n + z_dim * (4 + l + 1));
+    xp = rtld + n;
+    bp = xp + n;
+    t = bp + n;
+    tp = t + n;
+
+    r = itsol_getWORKvec(ws, 2 * (l + 1));
+    u = r + l + 1;
+    for (i = 0; i <= l; i++) {
+        r[i] = tp + (ITS_INT)(i + 1) * n;
+        u[i] = tp + (ITS_INT)(l + i + 2) * n;
+    }
 
-    tau = itsol_malloc(sizeof(*tau) * z_dim * (4 + l + 1), "bicgstabl");
+    tau = u[l] + n;
     gamma = &tau[z_dim * z_dim];
     gamma1 = &gamma[z_dim];
     gamma2 = &gamma1[z_dim];
     sigma = &gamma2[z_dim];
 
     /* set terminate tol */
-    Amat->matvec(Amat, x, tp);
+    itsol_matvec_st(Amat, x, tp);
     for (i = 0; i < n; i++) r[0][i] = rhs[i] - tp[i];
 
     itsol_copy(rtld, r[0], n);
@@ -58,6 +69,7 @@ int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, I
     for (i = 0; i < n; i++) u[0][i] = 0.;
 
     nrm2 = ires = itsol_norm2(r[0], n);
+    ndot++;
 
     end_solve = 0;
     if (nrm2 == 0.) {
@@ -83,18 +95,14 @@ int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, I
 
             /* rho1 = <rtld,r[j]> */
             rho1 = itsol_dot(rtld, r[j], n);
+            ndot++;
 
             /* test breakdown */
             if (fabs(rho1) == 0.0) {
                 for (i = 0; i < n; i++) t[i] = 0.;
 
                 /*  pc */
-                if (lu == NULL) {
-                    memcpy(t, x, n * sizeof(double));
-                }
-                else {
-                    lu->precon(x, t, lu);
-                }
+                itsol_precon_st(Amat, lu, x, t);
 
                 itsol_copy(x, t, n);
 
@@ -119,29 +127,20 @@ int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, I
             /* u[j+1] = M^-1 * u[j+1] */
             for (k = 0; k < n; k++) t[k] = 0.;
 
-            if (lu == NULL) {
-                memcpy(t, u[j], n * sizeof(double));
-            }
-            else {
-                lu->precon(u[j], t, lu);
-            }
+            itsol_precon_st(Amat, lu, u[j], t);
 
-            Amat->matvec(Amat, t, u[j + 1]);
+            itsol_matvec_st(Amat, t, u[j + 1]);
 
             /* nu = <rtld, u[j+1]> */
             nu = itsol_dot(rtld, u[j + 1], n);
+            ndot++;
 
             /* test breakdown */
             if (fabs(nu) == 0.0) {
                 for (k = 0; k < n; k++) t[k] = 0.;
 
                 /*  pc */
-                if (lu == NULL) {
-                    memcpy(t, x, n * sizeof(double));
-                }
-                else {
-                    lu->precon(x, t, lu);
-                }
+                itsol_precon_st(Amat, lu, x, t);
 
                 itsol_copy(x, t, n);
                 for (k = 0; k < n; k++) x[k] = x[k] + xp[k];
@@ -160,18 +159,14 @@ int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, I
             }
 
             nrm2 = itsol_norm2(r[0], n);
+            ndot++;
             if (io.verb > 0 && fp != NULL) fprintf(fp, "%8d   %10.2e\n", iter, nrm2 / ires);
 
             if (nrm2 <= tol) {
                 for (k = 0; k < n; k++) t[k] = 0.;
 
                 /*  pc */
-                if (lu == NULL) {
-                    memcpy(t, x, n * sizeof(double));
-                }
-                else {
-                    lu->precon(x, t, lu);
-                }
+                itsol_precon_st(Amat, lu, x, t);
 
                 itsol_copy(x, t, n);
                 for (k = 0; k < n; k++) x[k] += xp[k];
@@ -186,20 +181,16 @@ int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, I
             for (k = 0; k < n; k++) t[k] = 0.;
 
             /*  pc */
-            if (lu == NULL) {
-                memcpy(t, r[j], n * sizeof(double));
-            }
-            else {
-                lu->precon(r[j], t, lu);
-            }
+            itsol_precon_st(Amat, lu, r[j], t);
 
-            Amat->matvec(Amat, t, r[j + 1]);
+            itsol_matvec_st(Amat, t, r[j + 1]);
         }
 
         /* MR PART */
         for (j = 1; j <= l; j++) {
             for (i = 1; i <= j - 1; i++) {
                 nu = itsol_dot(r[j], r[i], n);
+                ndot++;
                 nu = nu / sigma[i];
                 tau[i * z_dim + j] = nu;
 
@@ -208,6 +199,7 @@ int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, I
 
             sigma[j] = itsol_dot(r[j], r[j], n);
             nu = itsol_dot(r[0], r[j], n);
+            ndot += 2;
             gamma1[j] = nu / sigma[j];
         }
 
@@ -245,12 +237,7 @@ int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, I
             for (k = 0; k < n; k++) t[k] = 0.;
 
             /*  pc */
-            if (lu == NULL) {
-                memcpy(t, x, n * sizeof(double));
-            }
-            else {
-                lu->precon(x, t, lu);
-            }
+            itsol_precon_st(Amat, lu, x, t);
 
             itsol_copy(x, t, n);
             for (k = 0; k < n; k++) x[k] += xp[k];
@@ -261,23 +248,13 @@ int itsol_solver_bicgstabl(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *x, I
     }
 
 end:
+    if (Amat->stats != NULL) Amat->stats->ndot += ndot;
     if (iter < maxits) iter += 1;
 
     if (nits != NULL) *nits = iter;
     if (res != NULL) *res = nrm2 / ires;
 
-    free(rtld);
-    free(xp);
-    free(bp);
-    free(tp);
-    free(t);
-
-    for (i = 0; i <= l; i++) free(r[i]);
-    free(r);
-
-    for (i = 0; i <= l; i++) free(u[i]);
-    free(u);
-    free(tau);
+    if (ws == &local) itsol_cleanWORK(&local);
 
     return 0;
 }
@@ -41,22 +41,33 @@
   +---------------------------------------------------------------------*/
 int itsol_solver_fgmres(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
         int *nits, double *res)
+{
+    return itsol_solver_fgmres_ws(Amat, lu, rhs, sol, io, nits, res, NULL);
+}
+
+/*----------------------------------------------------------------------
+  | same as itsol_solver_fgmres, the work arrays vv, hh, z are taken from
+  | ws (kept for the next call) or allocated for this call if ws == NULL.
+  +---------------------------------------------------------------------*/
+int itsol_solver_fgmres_ws(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
+        int *nits, double *res, ITS_WORK *ws)
 {
     int n = Amat->n;
-    int i, i1, ii, j, k, k1, its, im1, pti, pti1, ptih = 0, retval, one = 1;
+    int i, i1, ii, j, k, k1, its, im1, ptih = 0, retval, one = 1, ndot = 0;
+    ITS_INT pti, pti1;
     double *hh, *c, *s, *rs, t;
     double negt, beta, eps1 = 0, gam, *vv, *z;
     int im = io.restart, maxits = io.maxits;
     FILE * fp = io.fp;
     double tol = io.tol;
+    ITS_WORK local = {NULL, 0, NULL, 0};
 
     im1 = im + 1;
+    if (ws == NULL) ws = &local;
 
-    vv = (double *)itsol_malloc(im1 * n * sizeof(double), "fgmres:vv");
-    z = (double *)itsol_malloc(im * n * sizeof(double), "fgmres:z");
-
-    im1 = im + 1;
-    hh = (double *)itsol_malloc((im1 * (im + 3)) * sizeof(double), "fgmres:hh");
+    vv = itsol_getWORK(ws, (ITS_INT)(im1 + im) * n + im1 * (im + 3));
+    z = vv + (ITS_INT)im1 * n;
+    hh = z + (ITS_INT)im * n;
     c = hh + im1 * im;
     s = c + im1;
     rs = s + im1;
@@ -67,10 +78,11 @@ int itsol_solver_fgmres(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, IT
     /*-------------------- Outer loop */
     while (its < maxits) {
         /*-------------------- compute initial residual vector */
-        Amat->matvec(Amat, sol, vv);
+        itsol_matvec_st(Amat, sol, vv);
         for (j = 0; j < n; j++) vv[j] = rhs[j] - vv[j];     /*  vv[0]= initial residual */
 
         beta = itsol_dnrm2(n, vv, one);
+        ndot++;
 
         /*-------------------- print info if fp != null */
         if (fp != NULL && its == 0)
@@ -98,20 +110,17 @@ int itsol_solver_fgmres(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, IT
         while ((i < im - 1) && (beta > eps1) && (its++ < maxits)) {
             i++;
             i1 = i + 1;
-            pti = i * n;
-            pti1 = i1 * n;
+            pti = (ITS_INT)i * n;
+            pti1 = (ITS_INT)i1 * n;
 
             /*------------------------------------------------------------
               |  (Right) Preconditioning Operation   z_{j} = M^{-1} v_{j}
               +-----------------------------------------------------------*/
 
-            if (lu == NULL)
-                memcpy(z + pti, vv + pti, n * sizeof(double));
-            else
-                lu->precon(vv + pti, z + pti, lu);
+            itsol_precon_st(Amat, lu, vv + pti, z + pti);
 
             /*-------------------- matvec operation w = A z_{j} = A M^{-1} v_{j} */
-            Amat->matvec(Amat, &z[pti], &vv[pti1]);
+            itsol_matvec_st(Amat, &z[pti], &vv[pti1]);
 
             /*-------------------- modified gram - schmidt...
               |     h_{i,j} = (w,v_{i});  
@@ -119,16 +128,21 @@ int itsol_solver_fgmres(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, IT
               +------------------------------------------------------------*/
             ptih = i * im1;
             for (j = 0; j <= i; j++) {
-                t = itsol_ddot(n, &vv[j * n], one, &vv[pti1], one);
+                t = itsol_ddot(n, &vv[(ITS_INT)j * n], one, &vv[pti1], one);
                 hh[ptih + j] = t;
                 negt = -t;
-                itsol_daxpy(n, negt, &vv[j * n], one, &vv[pti1], one);
+                itsol_daxpy(n, negt, &vv[(ITS_INT)j * n], one, &vv[pti1], one);
             }
+            ndot += i + 1;
 
             /*-------------------- h_{j+1,j} = ||w||_{2}    */
             t = itsol_dnrm2(n, &vv[pti1], one);
+            ndot++;
             hh[ptih + i1] = t;
-            if (t == 0.0) return (1);
+            if (t == 0.0) {
+                retval = 1;
+                goto done;
+            }
             t = 1.0 / t;
 
             /*-------------------- v_{j+1} = w / h_{j+1,j}  */
@@ -176,7 +190,7 @@ int itsol_solver_fgmres(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, IT
         }
 
         /*---------- linear combination of z_j's to get sol. */
-        for (j = 0; j <= i; j++) itsol_daxpy(n, rs[j], &z[j * n], one, sol, one);
+        for (j = 0; j <= i; j++) itsol_daxpy(n, rs[j], &z[(ITS_INT)j * n], one, sol, one);
 
         /*--------------------  restart outer loop if needed */
         if (beta < eps1)
@@ -186,9 +200,10 @@ int itsol_solver_fgmres(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, IT
     }
 
     *nits = its;
-    free(vv);
-    free(z);
-    free(hh);
+
+done:
+    if (Amat->stats != NULL) Amat->stats->ndot += ndot;
+    if (ws == &local) itsol_cleanWORK(&local);
 
     return retval;
 }
@@ -0,0 +1,392 @@
+#include "solver-pgmres.h"
+
+#ifdef ITSOL_USE_OPENMP
+#include <omp.h>
+#endif
+
+#define  epsmac  1.0e-16
+
+/* below this fraction of (z_i, z_i) the norm of v_i is recomputed from
+   the vector, the difference of the two sums has lost too many digits */
+#define  epsh    1.0e-8
+
+/* the rounding errors of the z recurrence grow by |z_i| / h_{i,i-1} a
+   step; z_{i+1} is recomputed from v_i before they reach epsz * tol */
+#define  epsz    1.0e-4
+
+/* rows per partial sum of the fused dot products */
+#define  DOTBLK  1024
+
+/* partial sums of block b of the inner products of mdot_ */
+static void mdot_blk_(int n, int k, double *vv, double *x, double *part, int b)
+{
+    int j, one = 1, r0 = b * DOTBLK, len = its_min(DOTBLK, n - r0);
+    double *pb = part + (size_t)b * (k + 1);
+
+    for (j = 0; j < k; j++)
+        pb[j] = itsol_ddot(len, vv + (ITS_INT)j * n + r0, one, x + r0, one);
+    pb[k] = itsol_ddot(len, x + r0, one, x + r0, one);
+}
+
+/* d = sum of the partial sums of the blocks, in order */
+static void mdot_sum_(int n, int k, double *d, double *part)
+{
+    int b, j, nb = (n + DOTBLK - 1) / DOTBLK;
+
+    for (j = 0; j <= k; j++) {
+        d[j] = 0.0;
+        for (b = 0; b < nb; b++)
+            d[j] += part[(size_t)b * (k + 1) + j];
+    }
+}
+
+/*----------------------------------------------------------------------
+  | d[j] = (v_j, x) for j < k and d[k] = (x, x), in one pass over x: the
+  | single reduction of a step. The partial sums of fixed blocks of rows
+  | are added in order, so that the result does not depend on the
+  | number of threads. part = (n / DOTBLK + 1) * (k + 1) doubles.
+  +---------------------------------------------------------------------*/
+static void mdot_(int n, int k, double *vv, double *x, double *d, double *part)
+{
+    int b, nb = (n + DOTBLK - 1) / DOTBLK;
+
+#ifdef ITSOL_USE_OPENMP
+    int par = omp_get_max_threads() > 1 && !omp_in_parallel() && n >= ITS_OMP_MIN_ROWS;
+
+#pragma omp parallel for schedule(static) if (par)
+#endif
+    for (b = 0; b < nb; b++)
+        mdot_blk_(n, k, vv, x, part, b);
+
+    mdot_sum_(n, k, d, part);
+}
+
+#ifdef ITSOL_USE_OPENMP
+/*----------------------------------------------------------------------
+  | mdot_ on x overlapped with y = A w: in one parallel region each
+  | thread adds up its blocks of the inner products and goes on to its
+  | part of the matvec (itsol_matvec_part) without waiting for the
+  | others; the partial sums are combined after the region. When the
+  | matvec of Amat has no such split it is done after the region.
+  +---------------------------------------------------------------------*/
+static void mdot_mv_(ITS_SMat *Amat, int k, double *vv, double *x, double *d, double *part,
+        double *w, double *y)
+{
+    int b, n = Amat->n, nb = (n + DOTBLK - 1) / DOTBLK, done = 0;
+    ITS_STATS *st = Amat->stats;
+    double t = 0;
+
+    if (st != NULL) t = itsol_get_time();
+
+#pragma omp parallel private(b)
+    {
+        int r, nt = omp_get_num_threads(), tid = omp_get_thread_num();
+
+#pragma omp for schedule(static) nowait
+        for (b = 0; b < nb; b++)
+            mdot_blk_(n, k, vv, x, part, b);
+
+        r = itsol_matvec_part(Amat, w, y, tid, nt);
+        if (tid == 0) done = !r;
+    }
+
+    mdot_sum_(n, k, d, part);
+
+    if (!done) {
+        itsol_matvec_st(Amat, w, y);
+        return;
+    }
+    if (st != NULL) {
+        st->t_matvec += itsol_get_time() - t;
+        st->nmatvec++;
+    }
+}
+#endif
+
+/*----------------------------------------------------------------------
+  | v_i     = (z_i     - sum_{j<i} h_j v_j)     * t
+  | z_{i+1} = (z_{i+1} - sum_{j<i} h_j z_{j+1}) * t     (if doz)
+  | one block of DOTBLK rows at a time for all the vectors.
+  +---------------------------------------------------------------------*/
+static void update_(int n, int i, double *h, double t, double *vv, double *zz, int doz)
+{
+    int r0, j;
+
+#ifdef ITSOL_USE_OPENMP
+    int par = omp_get_max_threads() > 1 && !omp_in_parallel() && n >= ITS_OMP_MIN_ROWS;
+
+#pragma omp parallel for private(j) schedule(static) if (par)
+#endif
+    for (r0 = 0; r0 < n; r0 += DOTBLK) {
+        int one = 1, len = its_min(DOTBLK, n - r0);
+        double a, *vi = vv + (ITS_INT)i * n + r0, *z1 = zz + (ITS_INT)(i + 1) * n + r0;
+
+        memcpy(vi, zz + (ITS_INT)i * n + r0, len * sizeof(double));
+        for (j = 0; j < i; j++) {
+            a = -h[j];
+            itsol_daxpy(len, a, vv + (ITS_INT)j * n + r0, one, vi, one);
+        }
+        a = t;
+        itsol_dscal(len, a, vi, one);
+
+        if (!doz) continue;
+
+        for (j = 0; j < i; j++) {
+            a = -h[j];
+            itsol_daxpy(len, a, zz + (ITS_INT)(j + 1) * n + r0, one, z1, one);
+        }
+        a = t;
+        itsol_dscal(len, a, z1, one);
+    }
+}
+
+/*----------------------------------------------------------------------
+  |            *** Preconditioned pipelined GMRES ***
+  +-----------------------------------------------------------------------
+  | p(1)-GMRES (Ghysels, Ashby, Meerbergen, Vanroose), B = A M^{-1}.
+  | Besides the Arnoldi basis v_j it keeps z_{j+1} = B v_j. Since
+  |
+  |     v_i     = (z_i - sum_{j<i} h_{j,i-1} v_j) / h_{i,i-1}
+  |     z_{i+1} = (B z_i - sum_{j<i} h_{j,i-1} z_{j+1}) / h_{i,i-1}
+  |
+  | the preconditioning and matvec of step i (B z_i) do not need the
+  | inner products of step i, which give column i-1 of H:
+  | h_{j,i-1} = (z_i, v_j) and h_{i,i-1}^2 = (z_i, z_i) - sum h_{j,i-1}^2.
+  | These are computed in one fused pass, one global reduction per
+  | step instead of the i+2 separate ones of the modified Gram-Schmidt
+  | of itsol_solver_fgmres.
+  |
+  | Threaded (ITSOL_USE_OPENMP, n >= ITS_OMP_MIN_ROWS), the reduction
+  | runs in the same parallel region as the matvec of B z_i: each
+  | thread adds up its blocks of the inner products, goes on to its
+  | rows of the matvec without waiting for the others, and the partial
+  | sums are combined after the region (mdot_mv_). M^{-1} z_i is
+  | applied just before, in the parallel regions of the preconditioner,
+  | which cannot share a team. Matrices whose matvec has no row split
+  | (itsol_matvec_part) do the matvec after the region.
+  |
+  | The rounding errors of z_{i+1} grow by |z_i| / h_{i,i-1} a step, and
+  | h_{i,i-1} loses digits to the difference of the two sums, which
+  | stalls the residual norm well above tol on nonsymmetric problems
+  | whatever the restart. Before the growth since the last explicit
+  | product reaches epsz * tol / epsmac, or when h_{i,i-1}^2 is not
+  | clearly positive, the step instead orthogonalizes v_i once more,
+  | normalizes it from the vector and computes z_{i+1} = B v_i. The
+  | growth of the previous step predicts such a step and B z_i is then
+  | not started; a step that was not predicted wastes one B z_i.
+  |
+  | The residual norm of a column is known one step after its matvec,
+  | so a converged cycle does one extra preconditioning and matvec. The
+  | solution is updated with M^{-1} (V y), one more preconditioning per
+  | cycle, hence the preconditioner must not change between steps.
+  +---------------------------------------------------------------------*/
+int itsol_solver_pgmres(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
+        int *nits, double *res)
+{
+    return itsol_solver_pgmres_ws(Amat, lu, rhs, sol, io, nits, res, NULL);
+}
+
+int itsol_solver_pgmres_ws(ITS_SMat *Amat, ITS_PC *lu, double *rhs, double *sol, ITS_PARS io,
+        int *nits, double *res, ITS_WORK *ws)
+{
+    int n = Amat->n;
+    int i, ii, j, k, k1, its, im1, col, last, rec, ovl, ptih = 0, retval, one = 1, ndot = 0;
+    double *hh, *c, *s, *rs, *d, *part, t, h, amp, grow, ampmax;
+    double beta, eps1 = 0, gam, *vv, *zz, *w, *pw, *vi;
+    int im = io.restart, maxits = io.maxits;
+    FILE * fp = io.fp;
+    double tol = io.tol;
+    ITS_WORK local = {NULL, 0, NULL, 0};
+#ifdef ITSOL_USE_OPENMP
+    int par = omp_get_max_threads() > 1 && !omp_in_parallel() && n >= ITS_OMP_MIN_ROWS;
+#endif
+
+    im1 = im + 1;
+    if (ws == NULL) ws = &local;
+    ampmax = its_max(epsz * tol / epsmac, 1.0);
+
+    vv = itsol_getWORK(ws, (ITS_INT)(2 * im1 + 2) * n + (ITS_INT)((n + DOTBLK - 1) / DOTBLK) * im1
+            + im1 * (im + 4));
+    zz = vv + (ITS_INT)im1 * n;
+    w = zz + (ITS_INT)im1 * n;
+    pw = w + n;
+    part = pw + n;
+    hh = part + (ITS_INT)((n + DOTBLK - 1) / DOTBLK) * im1;
+    c = hh + im1 * im;
+    s = c + im1;
+    rs = s + im1;
+    d = rs + im1;
+
+    /*-------------------- outer loop starts here */
+    retval = 0;
+    its = 0;
+    beta = 0.0;
+    /*-------------------- Outer loop */
+    while (its < maxits) {
+        /*-------------------- compute initial residual vector */
+        itsol_matvec_st(Amat, sol, vv);
+        for (j = 0; j < n; j++) vv[j] = rhs[j] - vv[j];     /*  vv[0]= initial residual */
+
+        beta = itsol_dnrm2(n, vv, one);
+        ndot++;
+
+        /*-------------------- print info if fp != null */
+        if (fp != NULL && its == 0)
+            if (io.verb > 0 && fp != NULL) fprintf(fp, "%8d   %10.2e\n", its, beta);
+
+        if (beta == 0.0) {
+            if (res != NULL) *res = beta;
+            break;
+        }
+
+        t = 1.0 / beta;
+
+        /*--------------------   normalize:  vv    =  vv   / beta, z_0 = v_0 */
+        itsol_dscal(n, t, vv, one);
+        memcpy(zz, vv, n * sizeof(double));
+        if (its == 0) eps1 = tol * beta;
+
+        /*--------------------initialize 1-st term  of rhs of hessenberg mtx */
+        rs[0] = beta;
+
+        /*-------------------- Krylov loop, step i completes column i-1 */
+        col = -1;
+        amp = grow = 1.0;
+        for (i = 0;; i++) {
+            last = i > 0 && (i == im || its + 1 >= maxits);
+
+            /*-------------------- the reduction on z_i, independent of
+              |                     z_{i+1} = A M^{-1} z_i: overlapped
+              |                     with the matvec when threaded */
+            ovl = 0;
+            rec = 0;
+            if (i > 0) {
+#ifdef ITSOL_USE_OPENMP
+                ovl = par && !last && amp * grow <= ampmax;
+                if (ovl) {
+                    itsol_precon_st(Amat, lu, zz + (ITS_INT)i * n, w);
+                    mdot_mv_(Amat, i, vv, zz + (ITS_INT)i * n, d, part, w,
+                            zz + (ITS_INT)(i + 1) * n);
+                }
+                else
+#endif
+                mdot_(n, i, vv, zz + (ITS_INT)i * n, d, part);
+                ndot += i + 1;
+
+                /*---------------- column i-1 of H but for h_{i,i-1} */
+                col = i - 1;
+                ptih = col * im1;
+                t = d[i];
+                for (j = 0; j < i; j++) {
+                    hh[ptih + j] = d[j];
+                    t -= d[j] * d[j];
+                }
+                rec = t <= epsh * d[i] || amp * sqrt(d[i] / t) > ampmax;
+            }
+
+            /*-------------------- z_{i+1} = A M^{-1} z_i, unless done above,
+              |                     column i-1 is the last one of the
+              |                     cycle or z_{i+1} is to be recomputed */
+            if (!last && !ovl && !rec) {
+                itsol_precon_st(Amat, lu, zz + (ITS_INT)i * n, w);
+                itsol_matvec_st(Amat, w, zz + (ITS_INT)(i + 1) * n);
+            }
+
+            if (i == 0) continue;
+
+            /*-------------------- v_i and z_{i+1} */
+            vi = vv + (ITS_INT)i * n;
+            if (!rec) {
+                h = sqrt(t);
+                update_(n, i, hh + ptih, 1.0 / h, vv, zz, !last);
+                grow = sqrt(d[i]) / h;
+                amp *= grow;
+            }
+            else {
+                /*---- v_i orthogonalized once more and normalized
+                  |    explicitly, z_{i+1} = A M^{-1} v_i from scratch */
+                update_(n, i, hh + ptih, 1.0, vv, zz, 0);
+                mdot_(n, i, vv, vi, d, part);
+                for (j = 0; j < i; j++) {
+                    hh[ptih + j] += d[j];
+                    t = -d[j];
+                    itsol_daxpy(n, t, vv + (ITS_INT)j * n, one, vi, one);
+                }
+                h = itsol_dnrm2(n, vi, one);
+                ndot += i + 2;
+                if (h > 0.0) {
+                    t = 1.0 / h;
+                    itsol_dscal(n, t, vi, one);
+                    if (!last) {
+                        itsol_precon_st(Amat, lu, vi, w);
+                        itsol_matvec_st(Amat, w, zz + (ITS_INT)(i + 1) * n);
+                    }
+                }
+                amp = 1.0;
+            }
+            hh[ptih + i] = h;
+            its++;
+
+            /*-------- now  update factorization of hh.
+              | perform previous transformations  on column col of h
+              +-------------------------------------------------------*/
+            for (k = 1; k <= col; k++) {
+                k1 = k - 1;
+                t = hh[ptih + k1];
+                hh[ptih + k1] = c[k1] * t + s[k1] * hh[ptih + k];
+                hh[ptih + k] = -s[k1] * t + c[k1] * hh[ptih + k];
+            }
+
+            gam = sqrt(pow(hh[ptih + col], 2) + pow(hh[ptih + i], 2));
+
+            /*-------------------- check if gamma is zero */
+            if (gam == 0.0) gam = epsmac;
+
+            /*-------------------- get  next plane rotation    */
+            c[col] = hh[ptih + col] / gam;
+            s[col] = hh[ptih + i] / gam;
+            rs[i] = -s[col] * rs[col];
+            rs[col] = c[col] * rs[col];
+
+            /*-------------------- get residual norm + test convergence*/
+            hh[ptih + col] = c[col] * hh[ptih + col] + s[col] * hh[ptih + i];
+            beta = fabs(rs[i]);
+
+            if (fp != NULL && io.verb > 0) fprintf(fp, "%8d   %10.2e\n", its, beta);
+
+            /* record res */
+            if (res != NULL) *res = beta;
+
+            if (last || beta <= eps1 || h == 0.0) break;
+        }
+
+        /*-------------------- now compute solution. 1st, solve upper triangular system*/
+        rs[col] = rs[col] / hh[ptih + col];
+        for (ii = col - 1; ii >= 0; ii--) {
+            t = rs[ii];
+            for (j = ii + 1; j <= col; j++)
+                t -= hh[j * im1 + ii] * rs[j];
+            rs[ii] = t / hh[ii * im1 + ii];
+        }
+
+        /*---------- sol = sol + M^{-1} (linear combination of v_j's) */
+        for (j = 0; j < n; j++) w[j] = 0.0;
+        for (j = 0; j <= col; j++) itsol_daxpy(n, rs[j], &vv[(ITS_INT)j * n], one, w, one);
+        itsol_precon_st(Amat, lu, w, pw);
+        t = 1.0;
+        itsol_daxpy(n, t, pw, one, sol, one);
+
+        /*--------------------  restart outer loop if needed */
+        if (beta < eps1)
+            break;
+        else if (its >= maxits)
+            retval = 1;
+    }
+
+    *nits = its;
+
+    if (Amat->stats != NULL) Amat->stats->ndot += ndot;
+    if (ws == &local) itsol_cleanWORK(&local);
+
+    return retval;
+}
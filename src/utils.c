@@ -1,5 +1,6 @@
 
 #include "utils.h"
+#include "bin-io.h"
 #include <strings.h>
 
 #if TIME_WITH_SYS_TIME
@@ -30,7 +31,7 @@ void itsol_errexit(char *f_str, ...)
     exit(-1);
 }
 
-void * itsol_malloc(int nbytes, char *msg)
+void * itsol_malloc(size_t nbytes, char *msg)
 {
     void *ptr;
 
@@ -38,7 +39,7 @@ void * itsol_malloc(int nbytes, char *msg)
 
     ptr = (void *)malloc(nbytes);
     if (ptr == NULL)
-        itsol_errexit("Not enough mem for %s. Requested size: %d bytes", msg, nbytes);
+        itsol_errexit("Not enough mem for %s. Requested size: %zu bytes", msg, nbytes);
 
     return ptr;
 }
@@ -74,9 +75,309 @@ int itsol_setupCS(ITS_SparMat *amat, int len, int job)
         amat->ma = (double **)itsol_malloc(len * sizeof(double *), "itsol_setupCS");
     else
         amat->ma = NULL;
+    amat->ia = NULL;
+    amat->jflat = NULL;
+    amat->mflat = NULL;
+    amat->fa = NULL;
+    amat->fflat = NULL;
+    amat->sched = NULL;
     return 0;
 }
 
+/*----------------------------------------------------------------------
+  | Switch a SpaFmt struct to flat storage.
+  |----------------------------------------------------------------------
+  | on entry:
+  |==========
+  | ( amat )  =  Pointer to a SpaFmt struct, amat->nzcount set.
+  |     job   =  0: allocate storage only, rows are filled by the caller
+  |              1: move the pattern of the rows into flat storage,
+  |                 the values are not yet allocated
+  |              2: move pattern and values into flat storage
+  |
+  | On return:
+  |===========
+  |
+  |  amat->ia, jflat, mflat  flat storage, rows in order 0..n-1
+  |      ->ja[i], ma[i]      point into jflat, mflat
+  |
+  |  The previous storage of the rows (separate rows or an older flat
+  |  block, e.g. after a row permutation) is released.
+  |
+  | integer value returned:
+  |             0   --> successful return.
+  |--------------------------------------------------------------------*/
+int itsol_csflat(ITS_SparMat *amat, int job)
+{
+    int i, len, n = amat->n, *jflat;
+    ITS_INT *ia;
+    double *mflat = NULL;
+
+    ia = (ITS_INT *)itsol_malloc((n + 1) * sizeof(ITS_INT), "csflat:1");
+    ia[0] = 0;
+    for (i = 0; i < n; i++)
+        ia[i + 1] = ia[i] + amat->nzcount[i];
+
+    jflat = (int *)itsol_malloc(ia[n] * sizeof(int), "csflat:2");
+    if (amat->ma)
+        mflat = (double *)itsol_malloc(ia[n] * sizeof(double), "csflat:3");
+
+    for (i = 0; i < n; i++) {
+        len = amat->nzcount[i];
+        if (len > 0 && job > 0) {
+            memcpy(&jflat[ia[i]], amat->ja[i], len * sizeof(int));
+            if (job == 2 && mflat)
+                memcpy(&mflat[ia[i]], amat->ma[i], len * sizeof(double));
+
+            if (amat->ia == NULL) {
+                free(amat->ja[i]);
+                if (job == 2 && amat->ma)
+                    free(amat->ma[i]);
+            }
+        }
+    }
+
+    if (amat->ia) {
+        free(amat->ia);
+        free(amat->jflat);
+        if (amat->mflat) free(amat->mflat);
+    }
+
+    amat->ia = ia;
+    amat->jflat = jflat;
+    amat->mflat = mflat;
+    for (i = 0; i < n; i++) {
+        len = amat->nzcount[i];
+        amat->ja[i] = len > 0 ? &jflat[ia[i]] : NULL;
+        if (amat->ma)
+            amat->ma[i] = len > 0 ? &mflat[ia[i]] : NULL;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+  | Switch the values of a SpaFmt struct to single precision.
+  |----------------------------------------------------------------------
+  | The values are rounded to float and the double ones freed: on return
+  | amat->ma is NULL and amat->fa[i] holds the values of row i, all of
+  | them in amat->fflat when amat is in flat storage. The triangular
+  | solves and the matvec family read them and accumulate in double.
+  | Nothing is done for a pattern-only matrix.
+  |
+  | integer value returned:
+  |             0   --> successful return.
+  |--------------------------------------------------------------------*/
+int itsol_csfloat(ITS_SparMat *amat)
+{
+    int i, k, len, n = amat->n;
+    float *fflat = NULL;
+
+    if (amat->ma == NULL) return 0;
+
+    amat->fa = (float **)itsol_malloc(its_max(n, 1) * sizeof(float *), "csfloat:1");
+    if (amat->ia)
+        fflat = (float *)itsol_malloc(its_max(amat->ia[n], 1) * sizeof(float), "csfloat:2");
+
+    for (i = 0; i < n; i++) {
+        len = amat->nzcount[i];
+        if (amat->ia)
+            amat->fa[i] = &fflat[amat->ia[i]];
+        else
+            amat->fa[i] = (float *)itsol_malloc(len * sizeof(float), "csfloat:3");
+
+        for (k = 0; k < len; k++)
+            amat->fa[i][k] = (float)amat->ma[i][k];
+
+        if (amat->ia == NULL && len > 0) free(amat->ma[i]);
+    }
+
+    if (amat->ia) {
+        free(amat->mflat);
+        amat->mflat = NULL;
+    }
+    free(amat->ma);
+    amat->ma = NULL;
+    amat->fflat = fflat;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+  | Level schedule of a triangular SpaFmt matrix, for the
+  | level-scheduled solves in itsol_Lsol, itsol_Usol, itsol_lusolC.
+  |----------------------------------------------------------------------
+  | on entry:
+  |==========
+  | ( amat )  =  Pointer to a SpaFmt struct, a lower (upper = 0) or
+  |              upper (upper = 1) triangular factor. A diagonal entry
+  |              stored in a row is ignored.
+  |
+  | On return:
+  |===========
+  |
+  |  amat->sched  level schedule, level of row i is one more than the
+  |               largest level of the rows it depends on. Left NULL
+  |               when the levels are too narrow to be worth a thread
+  |               barrier each (less than ITS_OMP_LEVEL_ROWS rows on
+  |               average) or the matrix is small.
+  |
+  | integer value returned:
+  |             0   --> schedule built.
+  |             1   --> matrix is not triangular, no schedule.
+  |             2   --> not worth it, no schedule.
+  |--------------------------------------------------------------------*/
+int itsol_levsched(ITS_SparMat *amat, int upper)
+{
+    int i, j, k, col, d, n = amat->n, nlev = 0, *depth, *lev;
+    ITS_LevSched *sched;
+
+    itsol_cleanLevSched(amat);
+    if (n < ITS_OMP_MIN_ROWS) return 2;
+
+    depth = (int *)itsol_malloc(n * sizeof(int), "levsched:1");
+    for (k = 0; k < n; k++) {
+        i = upper ? n - 1 - k : k;
+        d = 0;
+        for (j = 0; j < amat->nzcount[i]; j++) {
+            col = amat->ja[i][j];
+            if (col == i) continue;
+            if ((upper && col < i) || (!upper && col > i)) {
+                free(depth);
+                return 1;
+            }
+            if (depth[col] >= d) d = depth[col] + 1;
+        }
+        depth[i] = d;
+        if (d >= nlev) nlev = d + 1;
+    }
+
+    if (n < nlev * ITS_OMP_LEVEL_ROWS) {
+        free(depth);
+        return 2;
+    }
+
+    /*-------------------- bucket the rows by level, ascending inside one */
+    sched = (ITS_LevSched *)itsol_malloc(sizeof(ITS_LevSched), "levsched:2");
+    lev = (int *)itsol_malloc((nlev + 1) * sizeof(int), "levsched:3");
+    sched->rows = (int *)itsol_malloc(n * sizeof(int), "levsched:4");
+    sched->nlev = nlev;
+    sched->lev = lev;
+
+    memset(lev, 0, (nlev + 1) * sizeof(int));
+    for (i = 0; i < n; i++)
+        lev[depth[i] + 1]++;
+    for (j = 0; j < nlev; j++)
+        lev[j + 1] += lev[j];
+    for (i = 0; i < n; i++)
+        sched->rows[lev[depth[i]]++] = i;
+    for (j = nlev; j > 0; j--)
+        lev[j] = lev[j - 1];
+    lev[0] = 0;
+
+    free(depth);
+    amat->sched = sched;
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+  | Free the level schedule of a SpaFmt struct, if any.
+  |--------------------------------------------------------------------*/
+void itsol_cleanLevSched(ITS_SparMat *amat)
+{
+    if (amat->sched == NULL) return;
+
+    free(amat->sched->lev);
+    free(amat->sched->rows);
+    free(amat->sched);
+    amat->sched = NULL;
+}
+
+/*----------------------------------------------------------------------
+  | Independent diagonal blocks of the pattern of A (+ B) restricted to
+  | its first n rows and columns.
+  |----------------------------------------------------------------------
+  | on entry:
+  |==========
+  | ( A, B )  =  SpaFmt matrices with at least n rows, B may be NULL.
+  |              Typically the B block of an ARMS level, or its L and U
+  |              factors.
+  |
+  | On return:
+  |===========
+  |
+  |  blk      =  n+1 entries, block d is rows blk[d] .. blk[d+1]-1.
+  |              Row i starts a block when no row < i has an entry in a
+  |              column >= i and no row >= i one in a column < i, so
+  |              that the blocks are factored and solved independently.
+  |
+  | integer value returned: the number of blocks.
+  |--------------------------------------------------------------------*/
+int itsol_diagblocks(ITS_SparMat *A, ITS_SparMat *B, int n, int *blk)
+{
+    int i, k, m, nb = 0, reach = -1, *low;
+    ITS_SparMat *T;
+
+    low = (int *)itsol_malloc((n + 1) * sizeof(int), "diagblocks");
+    low[n] = n;
+    for (i = n - 1; i >= 0; i--) {
+        low[i] = its_min(i, low[i + 1]);
+        for (m = 0, T = A; m < 2 && T != NULL; m++, T = B)
+            for (k = 0; k < T->nzcount[i]; k++)
+                low[i] = its_min(low[i], T->ja[i][k]);
+    }
+
+    for (i = 0; i < n; i++) {
+        if (reach < i && low[i] >= i) blk[nb++] = i;
+        reach = its_max(reach, i);
+        for (m = 0, T = A; m < 2 && T != NULL; m++, T = B)
+            for (k = 0; k < T->nzcount[i]; k++)
+                reach = its_max(reach, T->ja[i][k]);
+    }
+    blk[nb] = n;
+
+    free(low);
+    return nb;
+}
+
+/*----------------------------------------------------------------------
+  | Work space of at least len doubles. The space is kept in the
+  | ITS_WORK struct and only reallocated when it is too small, its
+  | previous content is then lost.
+  |--------------------------------------------------------------------*/
+double *itsol_getWORK(ITS_WORK *w, ITS_INT len)
+{
+    if (w->len < len) {
+        if (w->buf) free(w->buf);
+        w->buf = (double *)itsol_malloc(len * sizeof(double), "getWORK");
+        w->len = len;
+    }
+    return w->buf;
+}
+
+/*----------------------------------------------------------------------
+  | Array of at least nvec vector pointers, same policy as itsol_getWORK.
+  |--------------------------------------------------------------------*/
+double **itsol_getWORKvec(ITS_WORK *w, int nvec)
+{
+    if (w->nvec < nvec) {
+        if (w->vec) free(w->vec);
+        w->vec = (double **)itsol_malloc(nvec * sizeof(double *), "getWORKvec");
+        w->nvec = nvec;
+    }
+    return w->vec;
+}
+
+/*----------------------------------------------------------------------
+  | Free up memory held by an ITS_WORK struct, the struct is reset.
+  |--------------------------------------------------------------------*/
+void itsol_cleanWORK(ITS_WORK *w)
+{
+    if (w->buf) free(w->buf);
+    if (w->vec) free(w->vec);
+    memset(w, 0, sizeof(*w));
+}
+
 /*----------------------------------------------------------------------
   | Free up memory allocated for SpaFmt structs.
   |----------------------------------------------------------------------
@@ -91,15 +392,27 @@ int itsol_cleanCS(ITS_SparMat *amat)
     if (amat == NULL) return 0;
     if (amat->n < 1) return 0;
 
-    for (i = 0; i < amat->n; i++) {
-        if (amat->nzcount[i] > 0) {
-            if (amat->ma)
-                free(amat->ma[i]);
-            free(amat->ja[i]);
+    if (amat->ia) {
+        free(amat->ia);
+        if (amat->jflat) free(amat->jflat);
+        if (amat->mflat) free(amat->mflat);
+        if (amat->fflat) free(amat->fflat);
+    }
+    else {
+        for (i = 0; i < amat->n; i++) {
+            if (amat->nzcount[i] > 0) {
+                if (amat->ma)
+                    free(amat->ma[i]);
+                if (amat->fa)
+                    free(amat->fa[i]);
+                free(amat->ja[i]);
+            }
         }
     }
 
     if (amat->ma) free(amat->ma);
+    if (amat->fa) free(amat->fa);
+    itsol_cleanLevSched(amat);
 
     free(amat->ja);
     free(amat->nzcount);
@@ -113,6 +426,9 @@ int itsol_cleanCOO(ITS_CooMat *amat)
     if (amat == NULL) return 0;
     if (amat->n < 1) return 0;
 
+    /* arrays inside a file mapping */
+    if (amat->map != NULL) return itsol_unmap_bin(amat);
+
     free(amat->ja);
     free(amat->ia);
     free(amat->ma);
@@ -143,6 +459,15 @@ int itsol_cscpy(ITS_SparMat *amat, ITS_SparMat *bmat)
     int j, len, size = amat->n;
     double *bma;
     int *bja;
+    /*-------------------- flat source: copy in one block */
+    if (amat->ia) {
+        for (j = 0; j < size; j++)
+            bmat->nzcount[j] = amat->nzcount[j];
+        itsol_csflat(bmat, 0);
+        memcpy(bmat->jflat, amat->jflat, amat->ia[size] * sizeof(int));
+        memcpy(bmat->mflat, amat->mflat, amat->ia[size] * sizeof(double));
+        return 0;
+    }
     /*------------------------------------------------------------*/
     for (j = 0; j < size; j++) {
         len = bmat->nzcount[j] = amat->nzcount[j];
@@ -192,6 +517,29 @@ int itsol_setupILU(ITS_ILUSpar *lu, int n)
 
     itsol_setupCS(lu->U, n, 1);
     lu->work = (int *)itsol_malloc(sizeof(int) * n, "itsol_setupILU");
+    lu->nsweep = 0;
+    lu->swk = NULL;
+    lu->ndom = 0;
+    lu->dom = NULL;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+  | Set the independent diagonal blocks of an ILUSpar struct (a copy of
+  | dom, ndom+1 entries), ndom <= 1 for none.
+  |--------------------------------------------------------------------*/
+int itsol_setupILUdom(ITS_ILUSpar *lu, int ndom, int *dom)
+{
+    if (lu->dom) free(lu->dom);
+    lu->dom = NULL;
+    lu->ndom = 0;
+
+    if (ndom <= 1 || dom == NULL) return 0;
+
+    lu->dom = (int *)itsol_malloc((ndom + 1) * sizeof(int), "itsol_setupILUdom");
+    memcpy(lu->dom, dom, (ndom + 1) * sizeof(int));
+    lu->ndom = ndom;
 
     return 0;
 }
@@ -215,6 +563,8 @@ int itsol_cleanILU(ITS_ILUSpar *lu)
     itsol_cleanCS(lu->U);
 
     if (lu->work) free(lu->work);
+    if (lu->swk) free(lu->swk);
+    if (lu->dom) free(lu->dom);
     free(lu);
     return 0;
 }
@@ -261,6 +611,7 @@ int itsol_setupVBMat(ITS_VBSparMat *vbmat, int n, int *nB)
     vbmat->ja = (int **)itsol_malloc(sizeof(int *) * n, "itsol_setupVBMat");
     vbmat->ba = (ITS_BData **) itsol_malloc(sizeof(ITS_BData *) * n, "itsol_setupVBMat");
     vbmat->D = NULL;
+    vbmat->fa = NULL;
     return 0;
 }
 
@@ -288,6 +639,8 @@ int itsol_cleanVBMat(ITS_VBSparMat *vbmat)
                 }
                 free(vbmat->ba[i]);
             }
+            if (vbmat->fa && vbmat->fa[i])
+                free(vbmat->fa[i]);
         }
         if (vbmat->D && vbmat->D[i])
             free(vbmat->D[i]);
@@ -297,6 +650,8 @@ int itsol_cleanVBMat(ITS_VBSparMat *vbmat)
     free(vbmat->ja);
     if (vbmat->ba)
         free(vbmat->ba);
+    if (vbmat->fa)
+        free(vbmat->fa);
     free(vbmat->nzcount);
     if (vbmat->bsz)
         free(vbmat->bsz);
@@ -304,18 +659,20 @@ int itsol_cleanVBMat(ITS_VBSparMat *vbmat)
     return 0;
 }
 
-int itsol_nnzVBMat(ITS_VBSparMat *vbmat)
+ITS_INT itsol_nnzVBMat(ITS_VBSparMat *vbmat)
 {
-    int nnz = 0, i, n = vbmat->n;
+    ITS_INT nnz = 0;
+    int i, n = vbmat->n;
     for (i = 0; i < n; i++) {
         nnz += vbmat->nzcount[i];
     }
     return nnz;
 }
 
-int itsol_memVBMat(ITS_VBSparMat *vbmat)
+ITS_INT itsol_memVBMat(ITS_VBSparMat *vbmat)
 {
-    int mem = 0, nnz, i, j, n = vbmat->n, *bsz = vbmat->bsz, dm;
+    ITS_INT mem = 0;
+    int nnz, i, j, n = vbmat->n, *bsz = vbmat->bsz, dm;
     for (i = 0; i < n; i++) {
         nnz = vbmat->nzcount[i];
         dm = 0;
@@ -327,6 +684,51 @@ int itsol_memVBMat(ITS_VBSparMat *vbmat)
     return mem;
 }
 
+/*----------------------------------------------------------------------
+  | Switch the blocks of a VBSpaFmt struct to single precision.
+  |----------------------------------------------------------------------
+  | bsz = block structure of the matrix (vbmat->bsz may be NULL)
+  |
+  | The blocks of row i are rounded to float and stored one after the
+  | other, column-major as before, in vbmat->fa[i]; the double blocks
+  | are freed and vbmat->ba is NULL on return. The inverted diagonal
+  | blocks D, if any, are left in double.
+  |
+  | integer value returned:
+  |             0   --> successful return.
+  |--------------------------------------------------------------------*/
+int itsol_vbfloat(ITS_VBSparMat *vbmat, int *bsz)
+{
+    int i, j, k, len, dim, sz, n = vbmat->n;
+    float *f;
+
+    if (vbmat->ba == NULL) return 0;
+
+    vbmat->fa = (float **)itsol_malloc(its_max(n, 1) * sizeof(float *), "vbfloat:1");
+
+    for (i = 0; i < n; i++) {
+        dim = ITS_B_DIM(bsz, i);
+        len = 0;
+        for (j = 0; j < vbmat->nzcount[i]; j++)
+            len += dim * ITS_B_DIM(bsz, vbmat->ja[i][j]);
+
+        f = vbmat->fa[i] = (float *)itsol_malloc(len * sizeof(float), "vbfloat:2");
+        for (j = 0; j < vbmat->nzcount[i]; j++) {
+            sz = dim * ITS_B_DIM(bsz, vbmat->ja[i][j]);
+            for (k = 0; k < sz; k++)
+                *f++ = (float)vbmat->ba[i][j][k];
+            free(vbmat->ba[i][j]);
+        }
+
+        if (vbmat->nzcount[i] > 0) free(vbmat->ba[i]);
+    }
+
+    free(vbmat->ba);
+    vbmat->ba = NULL;
+
+    return 0;
+}
+
 /*----------------------------------------------------------------------
   | Initialize VBILUSpar structs.
   |----------------------------------------------------------------------
@@ -547,6 +949,8 @@ int itsol_setupP4(ITS_Per4Mat *amat, int Bn, int Cn, ITS_SparMat *F, ITS_SparMat
 
     amat->F = F;
     amat->E = E;
+    amat->nblk = 0;
+    amat->blk = NULL;
     return 0;
 }
 
@@ -588,6 +992,10 @@ int itsol_cleanP4(ITS_Per4Mat *amat)
         itsol_cleanCS(amat->U);
         amat->U = NULL;
     }
+    if (amat->blk) {
+        free(amat->blk);
+        amat->blk = NULL;
+    }
 
     if (amat->prev == NULL)
         if (amat->wk) free(amat->wk);
@@ -757,6 +1165,65 @@ int itsol_csSplit4(ITS_SparMat *amat, int bsize, int csize, ITS_SparMat *B, ITS_
     if (itsol_setupCS(E, csize, 1)) goto label111;
     if (itsol_setupCS(C, csize, 1)) goto label111;
 
+    /*-------------------- flat storage: count, allocate once, then fill */
+    if (amat->ia) {
+        ITS_SparMat *lmat, *rmat;
+
+        for (j = 0; j < bsize + csize; j++) {
+            numl = 0;
+            rowz = amat->nzcount[j];
+            rowj = amat->ja[j];
+            for (j1 = 0; j1 < rowz; j1++)
+                if (rowj[j1] < bsize) numl++;
+
+            if (j < bsize) {
+                B->nzcount[j] = numl;
+                F->nzcount[j] = rowz - numl;
+            }
+            else {
+                E->nzcount[j - bsize] = numl;
+                C->nzcount[j - bsize] = rowz - numl;
+            }
+        }
+
+        itsol_csflat(B, 0);
+        itsol_csflat(F, 0);
+        itsol_csflat(E, 0);
+        itsol_csflat(C, 0);
+
+        for (j = 0; j < bsize + csize; j++) {
+            if (j < bsize) {
+                lmat = B;
+                rmat = F;
+                ind = j;
+            }
+            else {
+                lmat = E;
+                rmat = C;
+                ind = j - bsize;
+            }
+
+            numl = numr = 0;
+            rowz = amat->nzcount[j];
+            rowj = amat->ja[j];
+            rowm = amat->ma[j];
+            for (j1 = 0; j1 < rowz; j1++) {
+                newj = rowj[j1];
+                if (newj < bsize) {
+                    lmat->ja[ind][numl] = newj;
+                    lmat->ma[ind][numl] = rowm[j1];
+                    numl++;
+                }
+                else {
+                    rmat->ja[ind][numr] = newj - bsize;
+                    rmat->ma[ind][numr] = rowm[j1];
+                    numr++;
+                }
+            }
+        }
+        return 0;
+    }
+
     new1j = (int *)itsol_malloc(bsize * sizeof(int), "csSplit4:1");
     new2j = (int *)itsol_malloc(csize * sizeof(int), "csSplit4:2");
     new1m = (double *)itsol_malloc(bsize * sizeof(double), "csSplit4:3");
@@ -953,9 +1420,10 @@ int itsol_CSRcs(int n, double *a, int *ja, int *ia, ITS_SparMat *mat, int rsa)
   |             0   --> successful return.
   |             1   --> memory allocation error.
   |--------------------------------------------------------------------*/
-int itsol_COOcs(int n, int nnz, double *a, int *ja, int *ia, ITS_SparMat *bmat)
+static int COOcs_(int n, ITS_INT nnz, double *a, int *ja, int *ia, ITS_SparMat *bmat, int flat)
 {
-    int i, k, k1, l, job = 1;
+    int i, k1, l, job = 1;
+    ITS_INT k;
     int *len;
     /*-------------------- setup data structure for bmat (ITS_SparMat *) struct */
     if (itsol_setupCS(bmat, n, job)) {
@@ -972,12 +1440,13 @@ int itsol_COOcs(int n, int nnz, double *a, int *ja, int *ia, ITS_SparMat *bmat)
     for (k = 0; k < n; k++) {
         l = len[k];
         bmat->nzcount[k] = l;
-        if (l > 0) {
+        if (l > 0 && !flat) {
             bmat->ja[k] = (int *)itsol_malloc(l * sizeof(int), "COOcs:1");
             bmat->ma[k] = (double *)itsol_malloc(l * sizeof(double), "COOcs:2");
         }
         len[k] = 0;
     }
+    if (flat) itsol_csflat(bmat, 0);
     /*-------------------- Fill actual entries */
     for (k = 0; k < nnz; k++) {
         i = ia[k];
@@ -990,6 +1459,22 @@ int itsol_COOcs(int n, int nnz, double *a, int *ja, int *ia, ITS_SparMat *bmat)
     return 0;
 }
 
+int itsol_COOcs(int n, ITS_INT nnz, double *a, int *ja, int *ia, ITS_SparMat *bmat)
+{
+    return COOcs_(n, nnz, a, ja, ia, bmat, 0);
+}
+
+/*----------------------------------------------------------------------
+  | Convert COO matrix to SpaFmt struct in flat storage
+  |----------------------------------------------------------------------
+  | same as itsol_COOcs, but all rows of bmat share one column index
+  | and one value array (see itsol_csflat).
+  |--------------------------------------------------------------------*/
+int itsol_COOcsflat(int n, ITS_INT nnz, double *a, int *ja, int *ia, ITS_SparMat *bmat)
+{
+    return COOcs_(n, nnz, a, ja, ia, bmat, 1);
+}
+
 void itsol_coocsc(int n, int nnz, double *val, int *col, int *row, double **a, int **ja, int **ia, int job)
 {
     int i, *ir, *jc;
@@ -1122,6 +1607,143 @@ NEXT_ROW:
     return 0;
 }
 
+/*----------------------------------------------------------------------
+ *  Compressed C-style Sparse Row to sliced ELLPACK (SELL-C-sigma)
+ *----------------------------------------------------------------------
+ * on entry:
+ *----------
+ * csmat = Sparse Row format Matrix
+ * sigma = sorting window: rows are sorted by decreasing length inside
+ *         consecutive windows of sigma rows. sigma <= 1 keeps the
+ *         original row order (SELL-C-1).
+ *
+ * on return:
+ *-----------
+ * sell  = the matrix in SELL-C-sigma format, C = ITS_SELL_C
+ *
+ * ierr  = integer, error code.
+ *              0  -- normal termination
+ *---------------------------------------------------------------------*/
+int itsol_csrsellC(ITS_SparMat *csmat, int sigma, ITS_SellMat *sell)
+{
+    int n = csmat->n, C = ITS_SELL_C, nslices, i, k, r, s, w, len;
+    int maxlen = 0, *rows, *cnt, *tmp, *ja;
+    ITS_INT j;
+    double *ma;
+
+    nslices = (n + C - 1) / C;
+    if (sigma < 1) sigma = 1;
+
+    rows = (int *)itsol_malloc(nslices * C * sizeof(int), "csrsellC:1");
+    for (i = 0; i < nslices * C; i++)
+        rows[i] = i < n ? i : -1;
+
+    for (i = 0; i < n; i++)
+        maxlen = its_max(maxlen, csmat->nzcount[i]);
+
+    /*-------------------- sort each window by decreasing row length
+      (counting sort, stable) */
+    if (sigma > 1 && n > 0) {
+        cnt = (int *)itsol_malloc((maxlen + 2) * sizeof(int), "csrsellC:2");
+        tmp = (int *)itsol_malloc(sigma * sizeof(int), "csrsellC:3");
+        for (i = 0; i < n; i += sigma) {
+            w = its_min(sigma, n - i);
+            for (k = 0; k <= maxlen + 1; k++)
+                cnt[k] = 0;
+            for (k = 0; k < w; k++)
+                cnt[maxlen - csmat->nzcount[i + k] + 1]++;
+            for (k = 1; k <= maxlen + 1; k++)
+                cnt[k] += cnt[k - 1];
+            for (k = 0; k < w; k++)
+                tmp[cnt[maxlen - csmat->nzcount[i + k]]++] = i + k;
+            memcpy(&rows[i], tmp, w * sizeof(int));
+        }
+        free(cnt);
+        free(tmp);
+    }
+
+    /*-------------------- slice widths and offsets */
+    sell->sptr = (ITS_INT *)itsol_malloc((nslices + 1) * sizeof(ITS_INT), "csrsellC:4");
+    sell->slen = (int *)itsol_malloc(its_max(nslices, 1) * sizeof(int), "csrsellC:5");
+    sell->sptr[0] = 0;
+    for (s = 0; s < nslices; s++) {
+        w = 0;
+        for (r = 0; r < C; r++)
+            if (rows[s * C + r] >= 0)
+                w = its_max(w, csmat->nzcount[rows[s * C + r]]);
+        sell->slen[s] = w;
+        sell->sptr[s + 1] = sell->sptr[s] + w * C;
+    }
+
+    /*-------------------- copy entries, padding with zeros */
+    ja = (int *)itsol_malloc(sell->sptr[nslices] * sizeof(int), "csrsellC:6");
+    ma = (double *)itsol_malloc(sell->sptr[nslices] * sizeof(double), "csrsellC:7");
+    for (s = 0; s < nslices; s++) {
+        for (r = 0; r < C; r++) {
+            i = rows[s * C + r];
+            len = i >= 0 ? csmat->nzcount[i] : 0;
+            for (k = 0; k < sell->slen[s]; k++) {
+                j = sell->sptr[s] + k * C + r;
+                if (k < len) {
+                    ja[j] = csmat->ja[i][k];
+                    ma[j] = csmat->ma[i][k];
+                }
+                else {
+                    ja[j] = 0;
+                    ma[j] = 0.0;
+                }
+            }
+        }
+    }
+
+    sell->n = n;
+    sell->sigma = sigma;
+    sell->nslices = nslices;
+    sell->rows = rows;
+    sell->ja = ja;
+    sell->ma = ma;
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+ *  Copy the values of a CSR matrix into its SELL-C-sigma copy
+ *----------------------------------------------------------------------
+ * csmat = Sparse Row format Matrix, same pattern as when sell was built
+ *         by itsol_csrsellC
+ * sell  = values overwritten, padding untouched
+ *---------------------------------------------------------------------*/
+int itsol_sellvals(ITS_SparMat *csmat, ITS_SellMat *sell)
+{
+    int C = ITS_SELL_C, i, k, r, s;
+
+    for (s = 0; s < sell->nslices; s++) {
+        for (r = 0; r < C; r++) {
+            i = sell->rows[s * C + r];
+            if (i < 0) continue;
+            for (k = 0; k < csmat->nzcount[i]; k++)
+                sell->ma[sell->sptr[s] + k * C + r] = csmat->ma[i][k];
+        }
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+  | Free up memory allocated for SellMat structs.
+  |--------------------------------------------------------------------*/
+int itsol_cleanSELL(ITS_SellMat *sell)
+{
+    if (sell == NULL) return 0;
+
+    if (sell->sptr) free(sell->sptr);
+    if (sell->slen) free(sell->slen);
+    if (sell->rows) free(sell->rows);
+    if (sell->ja) free(sell->ja);
+    if (sell->ma) free(sell->ma);
+    free(sell);
+    return 0;
+}
+
 /*---------------------------------------------------------------------
  * get the column ID of block matrix by giving the column ID of the original
  * matrix
@@ -1148,10 +1770,11 @@ int itsol_col2vbcol(int col, ITS_VBSparMat *vbmat)
     return begin;
 }
 
-int itsol_nnz_vbilu(ITS_VBILUSpar *lu)
+ITS_INT itsol_nnz_vbilu(ITS_VBILUSpar *lu)
 {
     int *bsz = lu->bsz;
-    int nzcount, nnz = 0, i, j, col;
+    int i, j, col;
+    ITS_INT nzcount, nnz = 0;
     for (i = 0; i < lu->n; i++) {
         nzcount = 0;
         for (j = 0; j < lu->L->nzcount[i]; j++) {
@@ -1169,9 +1792,10 @@ int itsol_nnz_vbilu(ITS_VBILUSpar *lu)
     return nnz;
 }
 
-int itsol_nnz_ilu(ITS_ILUSpar *lu)
+ITS_INT itsol_nnz_ilu(ITS_ILUSpar *lu)
 {
-    int nnz = 0, i;
+    ITS_INT nnz = 0;
+    int i;
     for (i = 0; i < lu->n; i++) {
         nnz += lu->L->nzcount[i];
         nnz += lu->U->nzcount[i];
@@ -1180,9 +1804,9 @@ int itsol_nnz_ilu(ITS_ILUSpar *lu)
     return nnz;
 }
 
-int itsol_nnz_lev4(ITS_Per4Mat *levmat, int *lev, FILE * ft)
+ITS_INT itsol_nnz_lev4(ITS_Per4Mat *levmat, int *lev, FILE * ft)
 {
-    int nnzT, nnzL, nnzU, nnzF, nnzE, nnzDown = 0;
+    ITS_INT nnzT, nnzL, nnzU, nnzF, nnzE, nnzDown = 0;
     ITS_Per4Mat *nextmat;
 
     nnzL = itsol_nnz_cs(levmat->L);
@@ -1194,7 +1818,8 @@ int itsol_nnz_lev4(ITS_Per4Mat *levmat, int *lev, FILE * ft)
     if (ft) {
         if (*lev == 0)
             fprintf(ft, "\nnnz/lev used:      L        U        F        E    subtot\n");
-        fprintf(ft, "    Level %2d %8d %8d %8d %8d %8d\n", *lev, nnzL, nnzU, nnzF, nnzE, nnzT);
+        fprintf(ft, "    Level %2d %8" ITS_INT_FMT " %8" ITS_INT_FMT " %8" ITS_INT_FMT " %8" ITS_INT_FMT
+                " %8" ITS_INT_FMT "\n", *lev, nnzL, nnzU, nnzF, nnzE, nnzT);
     }
     (*lev)++;
     nextmat = levmat->next;
@@ -1204,9 +1829,10 @@ int itsol_nnz_lev4(ITS_Per4Mat *levmat, int *lev, FILE * ft)
     return (nnzT + nnzDown);
 }
 
-int itsol_nnz_cs(ITS_SparMat *A)
+ITS_INT itsol_nnz_cs(ITS_SparMat *A)
 {
-    int i, n = A->n, nnz = 0;
+    int i, n = A->n;
+    ITS_INT nnz = 0;
     for (i = 0; i < n; i++)
         nnz += A->nzcount[i];
     return nnz;
@@ -1216,12 +1842,13 @@ int itsol_nnz_cs(ITS_SparMat *A)
   | computes and prints out total number of nonzero elements
   | used in ARMS factorization 
   +--------------------------------------------------------*/
-int itsol_nnz_arms(ITS_ARMSpar *PreSt, FILE * ft)
+ITS_INT itsol_nnz_arms(ITS_ARMSpar *PreSt, FILE * ft)
 {
     ITS_Per4Mat *levmat = PreSt->levmat;
     ITS_ILUTSpar *ilschu = PreSt->ilus;
     int nlev = PreSt->nlev;
-    int ilev = 0, nnz_lev, nnz_sch, nnz_tot;
+    int ilev = 0;
+    ITS_INT nnz_lev, nnz_sch, nnz_tot;
     nnz_lev = 0;
     if (nlev)
         nnz_lev += itsol_nnz_lev4(levmat, &ilev, ft);
@@ -1231,9 +1858,9 @@ int itsol_nnz_arms(ITS_ARMSpar *PreSt, FILE * ft)
     nnz_tot = nnz_lev + nnz_sch;
     if (ft) {
         fprintf(ft, "\n");
-        fprintf(ft, "Total nonzeros for interm. blocks.... =  %10d\n", nnz_lev);
-        fprintf(ft, "Total nonzeros for last level ....... =  %10d\n", nnz_sch);
-        fprintf(ft, "Grand total.......................... =  %10d\n", nnz_tot);
+        fprintf(ft, "Total nonzeros for interm. blocks.... =  %10" ITS_INT_FMT "\n", nnz_lev);
+        fprintf(ft, "Total nonzeros for last level ....... =  %10" ITS_INT_FMT "\n", nnz_sch);
+        fprintf(ft, "Grand total.......................... =  %10" ITS_INT_FMT "\n", nnz_tot);
     }
     return nnz_tot;
 }
@@ -1591,13 +2218,22 @@ int itsol_CSClumC(ITS_SparMat *amat, ITS_ILUSpar *mat, int rsa)
 
 double itsol_get_time(void)
 {
-    struct timeval tv;
-    double t;
+#if defined(CLOCK_MONOTONIC) && !defined(_WIN32)
+    /* not affected by clock adjustments, ns resolution */
+    struct timespec ts;
 
-    gettimeofday(&tv, (struct timezone *)0);
-    t = tv.tv_sec + (double)tv.tv_usec * 1e-6;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+        return ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+    {
+        struct timeval tv;
+        double t;
 
-    return t;
+        gettimeofday(&tv, (struct timezone *)0);
+        t = tv.tv_sec + (double)tv.tv_usec * 1e-6;
+
+        return t;
+    }
 }
 
 int itsol_dumpCooMat(ITS_SparMat *A, int nglob, int, FILE * ft);
@@ -1693,14 +2329,24 @@ int itsol_SparTran(ITS_SparMat *amat, ITS_SparMat *bmat, int job, int flag)
             for (j = 0; j < amat->nzcount[i]; j++)
                 ind[aja[j]]++;
         }
-        /*--------------------  allocate space  */
-        for (i = 0; i < size; i++) {
-            bmat->ja[i] = (int *)itsol_malloc(ind[i] * sizeof(int), "SparTran:2");
-            bmat->nzcount[i] = ind[i];
-            if (job == 1) {
-                bmat->ma[i] = (double *)itsol_malloc(ind[i] * sizeof(double), "SparTran:3");
+        /*--------------------  flat storage follows amat */
+        if (amat->ia) {
+            for (i = 0; i < size; i++) {
+                bmat->nzcount[i] = ind[i];
+                ind[i] = 0;
+            }
+            itsol_csflat(bmat, 0);
+        }
+        else {
+            /*--------------------  allocate space  */
+            for (i = 0; i < size; i++) {
+                bmat->ja[i] = (int *)itsol_malloc(ind[i] * sizeof(int), "SparTran:2");
+                bmat->nzcount[i] = ind[i];
+                if (job == 1) {
+                    bmat->ma[i] = (double *)itsol_malloc(ind[i] * sizeof(double), "SparTran:3");
+                }
+                ind[i] = 0;
             }
-            ind[i] = 0;
         }
     }
     /*--------------------  now do the actual copying  */
@@ -2107,7 +2753,8 @@ void itsol_qsort3i(int *wa, int *cor1, int *cor2, int left, int right)
 
 int itsol_dumpArmsMat(ITS_ARMSpar *PreSt, FILE * ft)
 {
-    int lev, nnz, nglob = 0, old = 0;
+    int lev, nglob = 0, old = 0;
+    ITS_INT nnz;
     ITS_Per4Mat *levmat = PreSt->levmat;
     ITS_ILUTSpar *ilus = PreSt->ilus;
     int n = levmat->n;
@@ -2116,7 +2763,7 @@ int itsol_dumpArmsMat(ITS_ARMSpar *PreSt, FILE * ft)
 
     nnz = itsol_nnz_arms(PreSt, dummy) - itsol_nnz_cs(ilus->C);
 
-    fprintf(ft, " %d %d %d \n", n, n, nnz);
+    fprintf(ft, " %d %d %" ITS_INT_FMT " \n", n, n, nnz);
 
     old = 0;
     for (lev = 0; lev < nlev; lev++) {
@@ -2249,7 +2896,8 @@ ITS_CooMat itsol_read_coo(char *Fname)
     FILE *matf = NULL;
     double *aa;
     int *ii, *jj;
-    int k, n, nnz;
+    int k, n;
+    ITS_INT nnz, kk;
     ITS_CooMat A;
 
     char str[ITS_MAX_LINE];
@@ -2271,7 +2919,7 @@ ITS_CooMat itsol_read_coo(char *Fname)
 
     if (k == 99) exit(3);
 
-    sscanf(str, " %d %d %d", &n, &k, &nnz);
+    sscanf(str, " %d %d %" ITS_INT_SCN, &n, &k, &nnz);
     if (n != k) {
         fprintf(stdout, "This is not a square matrix -- stopping \n");
         exit(4);
@@ -2290,9 +2938,9 @@ ITS_CooMat itsol_read_coo(char *Fname)
     ii = A.ia = (int *)itsol_malloc(nnz * sizeof(int), "read_coo:5");
 
     /*-------------------- long live fortran77 --- */
-    for (k = 0; k < nnz; k++) {
-        fscanf(matf, "%d  %d  %s", &ii[k], &jj[k], str);
-        aa[k] = atof(str);
+    for (kk = 0; kk < nnz; kk++) {
+        fscanf(matf, "%d  %d  %s", &ii[kk], &jj[kk], str);
+        aa[kk] = atof(str);
     }
 
     fclose(matf);
@@ -2308,6 +2956,9 @@ double itsol_norm(double *x, int n)
     assert(n >= 0);
     if (n > 0) assert(x != NULL);
 
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for reduction(+:t) if (n >= ITS_OMP_MIN_ROWS)
+#endif
     for (i = 0; i < n; i++)  t += x[i] * x[i];
 
     return sqrt(t);
@@ -2321,6 +2972,9 @@ double itsol_dot(double *x, double *y, int n)
     assert(n >= 0);
     if (n > 0) assert(x != NULL && y != NULL);
 
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for reduction(+:t) if (n >= ITS_OMP_MIN_ROWS)
+#endif
     for (i = 0; i < n; i++)  t += x[i] * y[i];
 
     return t;
@@ -2347,5 +3001,8 @@ void itsol_axpby(double a, double *x, double b, double *y, int n)
     assert(n >= 0);
     if (n > 0) assert(x != NULL && y != NULL);
 
+#ifdef ITSOL_USE_OPENMP
+#pragma omp parallel for if (n >= ITS_OMP_MIN_ROWS)
+#endif
     for (i = 0; i < n; i++)  y[i] = x[i] * a + b * y[i];
 }